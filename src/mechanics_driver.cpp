@@ -62,6 +62,8 @@
 #include "option_parser.hpp"
 #include <string>
 #include <sstream>
+#include <vector>
+#include <algorithm>
 
 using namespace std;
 using namespace mfem;
@@ -105,6 +107,11 @@ void setBdrConditions(Mesh *mesh);
 // in the input grain map (e.g. from CA calculation)
 void reorderMeshElements(Mesh *mesh, const int *nxyz);
 
+// reorder mesh elements so that all of the elements with the same
+// attribute (grain id) are contiguous while otherwise keeping their
+// original relative ordering
+void reorderMeshElementsByGrain(Mesh *mesh);
+
 // Projects the element attribute to GridFunction nodes
 // This also assumes the GridFunction is an L2 FE space
 void projectElemAttr2GridFunc(Mesh *mesh, ParGridFunction *elem_attr);
@@ -296,6 +303,18 @@ int main(int argc, char *argv[])
          mesh.UniformRefinement();
       }
 
+      // This needs to happen after the serial refinement so its child elements
+      // also end up grouped by grain. The parallel refinement below happens after
+      // the sort, and the ParMesh elements can't be reordered. So, the grains are only
+      // guaranteed to be contiguous when there's no parallel refinement.
+      if (toml_opt.grain_sort) {
+         reorderMeshElementsByGrain(&mesh);
+         if (toml_opt.par_ref_levels > 0 && myid == 0) {
+            std::cout << "Warning: Mesh.grain_sort only keeps the elements of a grain together "
+                      << "when Mesh.ref_par = 0" << std::endl;
+         }
+      }
+
       pmesh = new ParMesh(MPI_COMM_WORLD, mesh);
       for (int lev = 0; lev < toml_opt.par_ref_levels; lev++) {
          pmesh->UniformRefinement();
@@ -321,9 +340,8 @@ int main(int argc, char *argv[])
    FiniteElementCollection *fe_coll = NULL;
    fe_coll = new  H1_FECollection(toml_opt.order, dim);
    ParFiniteElementSpace fe_space(pmesh, fe_coll, dim);
-   // All of our data is going to be saved off as element average of the field
-   // It would be nice if we could have it one day saved off as the raw quadrature
-   // fields as well to perform analysis on
+   // All of our visualization data is going to be saved off as element average of the field.
+   // The raw quadrature fields can also be saved off for analysis (see SystemDriver::WriteRawQpts).
    int order_0 = 0;
 
    // Here we're setting up a discontinuous so that we'll use later to interpolate
@@ -340,6 +358,10 @@ int main(int argc, char *argv[])
    } else if (toml_opt.xtal_type == XtalType::HCP) {
       gdot_size = 24;
    }
+   // Only the requested slip systems are saved off
+   if (!toml_opt.shear_rate_systems.empty()) {
+      gdot_size = toml_opt.shear_rate_systems.size();
+   }
    ParFiniteElementSpace l2_fes_gdots(pmesh, &l2_fec, gdot_size, mfem::Ordering::byVDIM);
 
    ParGridFunction vonMises(&l2_fes);
@@ -362,6 +384,7 @@ int main(int argc, char *argv[])
    ParGridFunction hardness(&l2_fes);
    ParGridFunction quats(&l2_fes_ori);
    ParGridFunction gdots(&l2_fes);
+   ParGridFunction gdot_sum(&l2_fes);
 
    if (toml_opt.mech_type == MechType::EXACMECH) {
       dpeff.SetSpace(&l2_fes_pl);
@@ -370,6 +393,7 @@ int main(int argc, char *argv[])
       hardness.SetSpace(&l2_fes_pl);
       quats.SetSpace(&l2_fes_ori);
       gdots.SetSpace(&l2_fes_gdots);
+      gdot_sum.SetSpace(&l2_fes_pl);
    }
 
    HYPRE_Int glob_size = fe_space.GlobalTrueVSize();
@@ -632,6 +656,61 @@ int main(int argc, char *argv[])
    const std::string basename = toml_opt.basename + ".bp";
    ADIOS2DataCollection *adios2_dc = new ADIOS2DataCollection(MPI_COMM_WORLD, basename, pmesh);
 #endif
+   // Only the fields listed in Visualizations.fields are projected and saved off
+   auto vis_field = [&toml_opt](const std::string &name) {
+      return std::find(toml_opt.vis_fields.begin(), toml_opt.vis_fields.end(), name) != toml_opt.vis_fields.end();
+   };
+   const std::vector<std::pair<std::string, ParGridFunction*> > vis_gfs = {
+      {"Displacement", &x_diff}, {"Stress", &stress}, {"Velocity", &v_cur},
+      {"VonMisesStress", &vonMises}, {"HydrostaticStress", &hydroStress},
+      {"DpEff", &dpeff}, {"EffPlasticStrain", &pleff}, {"LatticeOrientation", &quats},
+      {"ShearRate", &gdots}, {"ShearRateSum", &gdot_sum}, {"Hardness", &hardness}
+   };
+   auto register_fields = [&](DataCollection &dc) {
+      for (auto &field : vis_gfs) {
+         if (vis_field(field.first)) {
+            dc.RegisterField(field.first, field.second);
+         }
+      }
+   };
+   // The von Mises and hydrostatic stresses are computed from the element averaged stress
+   const bool vis_stress = vis_field("Stress") || vis_field("VonMisesStress") || vis_field("HydrostaticStress");
+   auto project_fields = [&]() {
+      if (vis_stress) {
+         oper.ProjectModelStress(stress);
+      }
+      if (vis_field("VonMisesStress")) {
+         oper.ProjectVonMisesStress(vonMises, stress);
+      }
+      if (vis_field("HydrostaticStress")) {
+         oper.ProjectHydroStress(hydroStress, stress);
+      }
+      if (vis_field("DpEff")) {
+         oper.ProjectDpEff(dpeff);
+      }
+      if (vis_field("EffPlasticStrain")) {
+         oper.ProjectEffPlasticStrain(pleff);
+      }
+      if (vis_field("LatticeOrientation")) {
+         oper.ProjectOrientation(quats);
+      }
+      if (vis_field("ShearRate")) {
+         oper.ProjectShearRate(gdots);
+      }
+      if (vis_field("ShearRateSum")) {
+         oper.ProjectShearRateSum(gdot_sum);
+      }
+      if (vis_field("Hardness")) {
+         oper.ProjectH(hardness);
+      }
+   };
+
+   if (toml_opt.visit || toml_opt.conduit || toml_opt.paraview || toml_opt.adios2) {
+      // We also want to project the values out originally
+      // so our initial values are correct
+      project_fields();
+   }
+
    if (toml_opt.paraview) {
       paraview_dc.SetLevelsOfDetail(toml_opt.order);
       paraview_dc.SetDataFormat(VTKFormat::BINARY);
@@ -643,27 +722,7 @@ int main(int argc, char *argv[])
       paraview_dc.SetTime(0.0);
       paraview_dc.Save();
 
-      paraview_dc.RegisterField("Displacement", &x_diff);
-      paraview_dc.RegisterField("Stress", &stress);
-      paraview_dc.RegisterField("Velocity", &v_cur);
-      paraview_dc.RegisterField("VonMisesStress", &vonMises);
-      paraview_dc.RegisterField("HydrostaticStress", &hydroStress);
-
-      if (toml_opt.mech_type == MechType::EXACMECH) {
-         // We also want to project the values out originally
-         // so our initial values are correct
-         oper.ProjectDpEff(dpeff);
-         oper.ProjectEffPlasticStrain(pleff);
-         oper.ProjectOrientation(quats);
-         oper.ProjectShearRate(gdots);
-         oper.ProjectH(hardness);
-
-         paraview_dc.RegisterField("DpEff", &dpeff);
-         paraview_dc.RegisterField("EffPlasticStrain", &pleff);
-         paraview_dc.RegisterField("LatticeOrientation", &quats);
-         paraview_dc.RegisterField("ShearRate", &gdots);
-         paraview_dc.RegisterField("Hardness", &hardness);
-      }
+      register_fields(paraview_dc);
    }
 
    if (toml_opt.visit) {
@@ -675,29 +734,7 @@ int main(int argc, char *argv[])
       visit_dc.SetTime(0.0);
       visit_dc.Save();
 
-      visit_dc.RegisterField("Displacement", &x_diff);
-      visit_dc.RegisterField("Stress", &stress);
-      visit_dc.RegisterField("Velocity", &v_cur);
-      visit_dc.RegisterField("VonMisesStress", &vonMises);
-      // visit_dc.RegisterQField("HydrostaticStressQ", &q_vonMises);
-      visit_dc.RegisterField("HydrostaticStress", &hydroStress);
-
-      if (toml_opt.mech_type == MechType::EXACMECH) {
-         // We also want to project the values out originally
-         // so our initial values are correct
-
-         oper.ProjectDpEff(dpeff);
-         oper.ProjectEffPlasticStrain(pleff);
-         oper.ProjectOrientation(quats);
-         oper.ProjectShearRate(gdots);
-         oper.ProjectH(hardness);
-
-         visit_dc.RegisterField("DpEff", &dpeff);
-         visit_dc.RegisterField("EffPlasticStrain", &pleff);
-         visit_dc.RegisterField("LatticeOrientation", &quats);
-         visit_dc.RegisterField("ShearRate", &gdots);
-         visit_dc.RegisterField("Hardness", &hardness);
-      }
+      register_fields(visit_dc);
    }
 
 #ifdef MFEM_USE_CONDUIT
@@ -709,27 +746,7 @@ int main(int argc, char *argv[])
       conduit_dc.SetTime(0.0);
       conduit_dc.Save();
 
-      conduit_dc.RegisterField("Displacement", &x_diff);
-      conduit_dc.RegisterField("Stress", &stress);
-      conduit_dc.RegisterField("Velocity", &v_cur);
-      conduit_dc.RegisterField("VonMisesStress", &vonMises);
-      conduit_dc.RegisterField("HydrostaticStress", &hydroStress);
-
-      if (toml_opt.mech_type == MechType::EXACMECH) {
-         // We also want to project the values out originally
-         // so our initial values are correct
-         oper.ProjectDpEff(dpeff);
-         oper.ProjectEffPlasticStrain(pleff);
-         oper.ProjectOrientation(quats);
-         oper.ProjectShearRate(gdots);
-         oper.ProjectH(hardness);
-
-         conduit_dc.RegisterField("DpEff", &dpeff);
-         conduit_dc.RegisterField("EffPlasticStrain", &pleff);
-         conduit_dc.RegisterField("LatticeOrientation", &quats);
-         conduit_dc.RegisterField("ShearRate", &gdots);
-         conduit_dc.RegisterField("Hardness", &hardness);
-      }
+      register_fields(conduit_dc);
    }
 #endif
 #ifdef MFEM_USE_ADIOS2
@@ -744,27 +761,7 @@ int main(int argc, char *argv[])
       adios2_dc->Save();
 
       adios2_dc->DeregisterField("ElementAttribute");
-      adios2_dc->RegisterField("Displacement", &x_diff);
-      adios2_dc->RegisterField("Stress", &stress);
-      adios2_dc->RegisterField("Velocity", &v_cur);
-      adios2_dc->RegisterField("VonMisesStress", &vonMises);
-      adios2_dc->RegisterField("HydrostaticStress", &hydroStress);
-
-      if (toml_opt.mech_type == MechType::EXACMECH) {
-         // We also want to project the values out originally
-         // so our initial values are correct
-         oper.ProjectDpEff(dpeff);
-         oper.ProjectEffPlasticStrain(pleff);
-         oper.ProjectOrientation(quats);
-         oper.ProjectShearRate(gdots);
-         oper.ProjectH(hardness);
-
-         adios2_dc->RegisterField("DpEff", &dpeff);
-         adios2_dc->RegisterField("EffPlasticStrain", &pleff);
-         adios2_dc->RegisterField("LatticeOrientation", &quats);
-         adios2_dc->RegisterField("ShearRate", &gdots);
-         adios2_dc->RegisterField("Hardness", &hardness);
-      }
+      register_fields(*adios2_dc);
    }
 #endif
    if (myid == 0) {
@@ -868,21 +865,15 @@ int main(int argc, char *argv[])
             cout << "step " << ti << ", t = " << t << endl;
          }
          CALI_MARK_BEGIN("main_vis_update");
+         oper.WriteRawQpts(ti, t);
+         oper.WriteGrainStats(ti, t);
+         oper.WriteLatticeStrains(ti, t);
+         oper.WriteHistograms(ti, t);
          if (toml_opt.visit || toml_opt.conduit || toml_opt.paraview || toml_opt.adios2) {
             // mesh and stress output. Consider moving this to a separate routine
             // We might not want to update the vonMises stuff
-            oper.ProjectModelStress(stress);
             oper.ProjectVolume(volume);
-            oper.ProjectVonMisesStress(vonMises, stress);
-            oper.ProjectHydroStress(hydroStress, stress);
-
-            if (toml_opt.mech_type == MechType::EXACMECH) {
-               oper.ProjectDpEff(dpeff);
-               oper.ProjectEffPlasticStrain(pleff);
-               oper.ProjectOrientation(quats);
-               oper.ProjectShearRate(gdots);
-               oper.ProjectH(hardness);
-            }
+            project_fields();
          }
 
          if (toml_opt.visit) {
@@ -917,6 +908,9 @@ int main(int argc, char *argv[])
       } // end output scope
    } // end loop over time steps
 
+   // The last time step's volume averages still need to be written out
+   oper.FinalizeVolAvgs();
+
    // Free the used memory.
    delete pmesh;
    // Now find out how long everything took to run roughly
@@ -1211,6 +1205,31 @@ void reorderMeshElements(Mesh *mesh, const int *nxyz)
    return;
 }
 
+void reorderMeshElementsByGrain(Mesh *mesh)
+{
+   const int nelems = mesh->GetNE();
+   // The elements sorted by their grain id where elements within
+   // the same grain retain their original order
+   std::vector<int> sorted(nelems);
+   for (int i = 0; i < nelems; ++i) {
+      sorted[i] = i;
+   }
+
+   std::stable_sort(sorted.begin(), sorted.end(), [mesh](const int a, const int b) {
+      return mesh->GetAttribute(a) < mesh->GetAttribute(b);
+   });
+
+   // ReorderElements wants the new index of each of the original elements
+   Array<int> order(nelems);
+   for (int i = 0; i < nelems; ++i) {
+      order[sorted[i]] = i;
+   }
+
+   mesh->ReorderElements(order, false);
+
+   return;
+}
+
 void setElementGrainIDs(Mesh *mesh, const Vector grainMap, int ncols, int offset)
 {
    // after a call to reorderMeshElements, the elements in the serial
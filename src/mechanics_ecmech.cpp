@@ -8,6 +8,7 @@
 #include "BCManager.hpp"
 #include <math.h> // log
 #include <algorithm>
+#include <vector>
 #include <iostream> // cerr
 #include "RAJA/RAJA.hpp"
 #include "mechanics_kernels.hpp"
@@ -19,12 +20,18 @@ using namespace ecmech;
 namespace {
 
 // Sets-up everything for the kernel
+// ExaCMech updates the state variables in place, so the beginning time step
+// state variables are copied over to the state variable array passed to ExaCMech here as well.
+// The beginning time step state variables are accessed through the provided layout
+// starting at the point offset, while state_vars_array is always in the format ExaCMech expects.
 void kernel_setup(const int npts, const int nstatev,
                   const double dt, const double temp_k, const double* vel_grad_array,
-                  const double* stress_array, const double* state_vars_array,
+                  const double* stress_array, const double* beg_state_vars_array,
+                  const RAJA::Layout<2> &state_vars_layout, const int ipts_offset,
+                  double* state_vars_array,
                   double* stress_svec_p_array, double* d_svec_p_array,
                   double* w_vec_array, double* vol_ratio_array,
-                  double* eng_int_array, double* tempk_array, double* dEff)
+                  double* eng_int_array, double* tempk_array)
 {
    // vgrad is kinda a pain to deal with as a raw 1d array, so we're
    // going to just use a RAJA view here. The data is taken to be in col. major format.
@@ -38,14 +45,15 @@ void kernel_setup(const int npts, const int nstatev,
    std::array<RAJA::idx_t, DIM> perm {{ 2, 1, 0 } };
    RAJA::Layout<DIM> layout = RAJA::make_permuted_layout({{ ecmech::ndim, ecmech::ndim, npts } }, perm);
    RAJA::View<const double, RAJA::Layout<DIM, RAJA::Index_type, 0> > vgrad_view(vel_grad_array, layout);
+   RAJA::View<const double, RAJA::Layout<2> > beg_state_vars_view(beg_state_vars_array, state_vars_layout);
 
    MFEM_FORALL(i_pts, npts, {
          // Might want to eventually set these all up using RAJA views. It might simplify
          // things later on.
          // These are our inputs
-         const double* state_vars = &(state_vars_array[i_pts * nstatev]);
          const double* stress = &(stress_array[i_pts * ecmech::nsvec]);
          // Here is all of our ouputs
+         double* state_vars = &(state_vars_array[i_pts * nstatev]);
          double* eng_int = &(eng_int_array[i_pts * ecmech::ne]);
          double* w_vec = &(w_vec_array[i_pts * ecmech::nwvec]);
          double* vol_ratio = &(vol_ratio_array[i_pts * ecmech::nvr]);
@@ -56,6 +64,10 @@ void kernel_setup(const int npts, const int nstatev,
 
          tempk_array[i_pts] = temp_k;
 
+         for (int i = 0; i < nstatev; i++) {
+            state_vars[i] = beg_state_vars_view(i, ipts_offset + i_pts);
+         }
+
          for (int i = 0; i < ecmech::ne; i++) {
             eng_int[i] = state_vars[ind_int_eng + i];
          }
@@ -78,10 +90,6 @@ void kernel_setup(const int npts, const int nstatev,
          d_svec_p[5] = 0.5 * (vgrad_view(1, 0, i_pts) + vgrad_view(0, 1, i_pts));
          d_svec_p[6] = -3.0 * d_mean;
 
-         double d_vecd_sm[ecmech::ntvec];
-         ecmech::svecToVecd(d_vecd_sm, d_svec_p);
-         *dEff = ecmech::vecd_Deff(d_vecd_sm);
-
          vol_ratio[0] = state_vars[ind_vols];
          vol_ratio[1] = vol_ratio[0] * exp(d_svec_p[ecmech::iSvecP] * dt);
          vol_ratio[3] = vol_ratio[1] - vol_ratio[0];
@@ -103,9 +111,15 @@ void kernel_setup(const int npts, const int nstatev,
 // is sent back to the CPU for the time being. It also stores all of the state variables into their
 // appropriate vector. Finally, it saves off the material tangent stiffness vector. In the future,
 // if PA is used then the 4D 3x3x3x3 tensor is saved off rather than the 6x6 2D matrix.
-void kernel_postprocessing(const int npts, const int nstatev, const double dt, const double dEff,
-                           const double* stress_svec_p_array, const double* vol_ratio_array,
+// If scatter_state_vars is true, the state variables from ExaCMech are copied back out to the
+// end time step state variables using the provided layout. Otherwise, state_vars_array
+// is assumed to already be the end time step state variables.
+void kernel_postprocessing(const int npts, const int nstatev, const double dt,
+                           const double* d_svec_p_array, const double* stress_svec_p_array,
+                           const double* vol_ratio_array,
                            const double* eng_int_array, const double* beg_state_vars_array,
+                           double* end_state_vars_array, const RAJA::Layout<2> &state_vars_layout,
+                           const int ipts_offset, const bool scatter_state_vars,
                            double* state_vars_array, double* stress_array,
                            double* ddsdde_array)
 {
@@ -113,10 +127,12 @@ void kernel_postprocessing(const int npts, const int nstatev, const double dt, c
    const int ind_pl_work = ecmech::evptn::iHistA_flowStr;
    const int ind_vols = ind_int_eng - 1;
 
+   RAJA::View<const double, RAJA::Layout<2> > beg_state_vars_view(beg_state_vars_array, state_vars_layout);
+   RAJA::View<double, RAJA::Layout<2> > end_state_vars_view(end_state_vars_array, state_vars_layout);
+
    MFEM_FORALL(i_pts, npts, {
          // These are our outputs
          double* state_vars = &(state_vars_array[i_pts * nstatev]);
-         const double* beg_state_vars = &(beg_state_vars_array[i_pts * nstatev]);
          double* stress = &(stress_array[i_pts * ecmech::nsvec]);
          // Here is all of our ouputs
          const double* eng_int = &(eng_int_array[i_pts * ecmech::ne]);
@@ -124,6 +140,7 @@ void kernel_postprocessing(const int npts, const int nstatev, const double dt, c
          // A few variables are set up as the 6-vec deviatoric + tr(tens) values
          int ind_svecp = i_pts * ecmech::nsvp;
          const double* stress_svec_p = &(stress_svec_p_array[ind_svecp]);
+         const double* d_svec_p = &(d_svec_p_array[ind_svecp]);
 
          // We need to update our state variables to include the volume ratio and
          // internal energy portions
@@ -132,12 +149,23 @@ void kernel_postprocessing(const int npts, const int nstatev, const double dt, c
             state_vars[ind_int_eng + i] = eng_int[i];
          }
 
+         // The effective deformation rate of this point is what scales our plastic work
+         double d_vecd_sm[ecmech::ntvec];
+         ecmech::svecToVecd(d_vecd_sm, d_svec_p);
+         const double dEff = ecmech::vecd_Deff(d_vecd_sm);
+
          if(dEff > ecmech::idp_tiny_sqrt) {
             state_vars[ind_pl_work] *= dEff * dt;
          } else {
             state_vars[ind_pl_work] = 0.0;
          }
-         state_vars[ind_pl_work] += beg_state_vars[ind_pl_work];
+         state_vars[ind_pl_work] += beg_state_vars_view(ind_pl_work, ipts_offset + i_pts);
+
+         if (scatter_state_vars) {
+            for (int i = 0; i < nstatev; i++) {
+               end_state_vars_view(i, ipts_offset + i_pts) = state_vars[i];
+            }
+         }
 
          // Here we're converting back from our deviatoric + pressure representation of our
          // Cauchy stress back to the Voigt notation of stress.
@@ -149,9 +177,7 @@ void kernel_postprocessing(const int npts, const int nstatev, const double dt, c
          stress[0] += stress_mean;
          stress[1] += stress_mean;
          stress[2] += stress_mean;
-      }); // end of npts loop
 
-   MFEM_FORALL(i_pts, npts, {
          // ExaCMech saves this in Row major, so we need to get out the transpose.
          // The good thing is we can do this all in place no problem.
          double* ddsdde = &(ddsdde_array[i_pts * ecmech::nsvec * ecmech::nsvec]);
@@ -162,7 +188,7 @@ void kernel_postprocessing(const int npts, const int nstatev, const double dt, c
                ddsdde[(ecmech::nsvec * i) +j] = tmp;
             }
          }
-      });
+      }); // end of npts loop
 } // end of post-processing func
 
 // The different CPU, OpenMP, and GPU kernels aren't needed here, since they're
@@ -179,10 +205,199 @@ void kernel(const ecmech::matModelBase* mat_model_base,
                                tempk_array, sdd_array, ddsdde_array, npts);
 }
 
+// Runs the material model over only the points that weren't screened out as being elastic.
+// Those points are gathered into the compacted scratch space, run through the material model,
+// and then their outputs are scattered back out to the block's arrays.
+// This is only ever run on the host.
+void kernel_screened(const ecmech::matModelBase* mat_model_base,
+                     const int npts, const int nstatev, const double dt,
+                     const double* elastic_array, double* scr_array,
+                     double* state_vars_array, double* stress_svec_p_array,
+                     double* d_svec_p_array, double* w_vec_array,
+                     double* ddsdde_array, double* vol_ratio_array,
+                     double* eng_int_array, double* tempk_array,
+                     double* sdd_array)
+{
+   const int nddsdde = ecmech::nsvec * ecmech::nsvec;
+   double* state_vars_scr = scr_array;
+   double* stress_svec_p_scr = state_vars_scr + npts * nstatev;
+   double* d_svec_p_scr = stress_svec_p_scr + npts * ecmech::nsvp;
+   double* w_vec_scr = d_svec_p_scr + npts * ecmech::nsvp;
+   double* ddsdde_scr = w_vec_scr + npts * ecmech::nwvec;
+   double* vol_ratio_scr = ddsdde_scr + npts * nddsdde;
+   double* eng_int_scr = vol_ratio_scr + npts * ecmech::nvr;
+   double* tempk_scr = eng_int_scr + npts * ecmech::ne;
+   double* sdd_scr = tempk_scr + npts;
+
+   // Gather all of the remaining points
+   std::vector<int> active;
+   active.reserve(npts);
+   for (int i_pts = 0; i_pts < npts; i_pts++) {
+      if (elastic_array[i_pts] > 0.0) { continue; }
+      const int i_act = active.size();
+      active.push_back(i_pts);
+      std::copy_n(&state_vars_array[i_pts * nstatev], nstatev, &state_vars_scr[i_act * nstatev]);
+      std::copy_n(&stress_svec_p_array[i_pts * ecmech::nsvp], ecmech::nsvp, &stress_svec_p_scr[i_act * ecmech::nsvp]);
+      std::copy_n(&d_svec_p_array[i_pts * ecmech::nsvp], ecmech::nsvp, &d_svec_p_scr[i_act * ecmech::nsvp]);
+      std::copy_n(&w_vec_array[i_pts * ecmech::nwvec], ecmech::nwvec, &w_vec_scr[i_act * ecmech::nwvec]);
+      std::copy_n(&vol_ratio_array[i_pts * ecmech::nvr], ecmech::nvr, &vol_ratio_scr[i_act * ecmech::nvr]);
+      std::copy_n(&eng_int_array[i_pts * ecmech::ne], ecmech::ne, &eng_int_scr[i_act * ecmech::ne]);
+      tempk_scr[i_act] = tempk_array[i_pts];
+   }
+
+   const int n_active = active.size();
+   if (n_active == 0) { return; }
+
+   kernel(mat_model_base, n_active, dt, state_vars_scr,
+          stress_svec_p_scr, d_svec_p_scr, w_vec_scr,
+          ddsdde_scr, vol_ratio_scr, eng_int_scr,
+          tempk_scr, sdd_scr);
+
+   // Scatter the outputs back to their original points
+   for (int i_act = 0; i_act < n_active; i_act++) {
+      const int i_pts = active[i_act];
+      std::copy_n(&state_vars_scr[i_act * nstatev], nstatev, &state_vars_array[i_pts * nstatev]);
+      std::copy_n(&stress_svec_p_scr[i_act * ecmech::nsvp], ecmech::nsvp, &stress_svec_p_array[i_pts * ecmech::nsvp]);
+      std::copy_n(&eng_int_scr[i_act * ecmech::ne], ecmech::ne, &eng_int_array[i_pts * ecmech::ne]);
+      std::copy_n(&ddsdde_scr[i_act * nddsdde], nddsdde, &ddsdde_array[i_pts * nddsdde]);
+      std::copy_n(&sdd_scr[i_act * ecmech::nsdd], ecmech::nsdd, &sdd_array[i_pts * ecmech::nsdd]);
+   }
+}
+
+// Re-integrates the points whose nonlinear solve took more than max_evals evaluations
+// over several sub-increments of the time step starting back from the beginning time step values.
+// The velocity gradient is held constant over the time step, so every sub-increment sees
+// the same deformation rate and spin. The number of sub-increments is doubled for any
+// point that still takes more than max_evals evaluations in a single sub-increment
+// until max_substeps is reached, and the last result is what's kept for those points.
+// The material tangent stiffness matrix is the one from the last sub-increment.
+// This is only ever run on the host.
+void kernel_substep(const ecmech::matModelBase* mat_model_base,
+                    const int npts, const int nstatev, const double dt,
+                    const int max_substeps, const int max_evals,
+                    const double* stress_array, const double* beg_state_vars_array,
+                    const RAJA::Layout<2> &state_vars_layout, const int ipts_offset,
+                    double* scr_array, double* state_vars_array,
+                    double* stress_svec_p_array, const double* d_svec_p_array,
+                    const double* w_vec_array, double* ddsdde_array,
+                    double* vol_ratio_array, double* eng_int_array,
+                    const double* tempk_array, double* sdd_array)
+{
+   const int ind_int_eng = nstatev - ecmech::ne;
+   const int ind_vols = ind_int_eng - 1;
+   const int ind_pl_work = ecmech::evptn::iHistA_flowStr;
+   const int ind_num_evals = ecmech::evptn::iHistA_nFEval;
+   const int nddsdde = ecmech::nsvec * ecmech::nsvec;
+
+   double* state_vars_scr = scr_array;
+   double* stress_svec_p_scr = state_vars_scr + npts * nstatev;
+   double* d_svec_p_scr = stress_svec_p_scr + npts * ecmech::nsvp;
+   double* w_vec_scr = d_svec_p_scr + npts * ecmech::nsvp;
+   double* ddsdde_scr = w_vec_scr + npts * ecmech::nwvec;
+   double* vol_ratio_scr = ddsdde_scr + npts * nddsdde;
+   double* eng_int_scr = vol_ratio_scr + npts * ecmech::nvr;
+   double* tempk_scr = eng_int_scr + npts * ecmech::ne;
+   double* sdd_scr = tempk_scr + npts;
+
+   RAJA::View<const double, RAJA::Layout<2> > beg_state_vars_view(beg_state_vars_array, state_vars_layout);
+
+   std::vector<int> hard;
+   for (int i_pts = 0; i_pts < npts; i_pts++) {
+      if (state_vars_array[i_pts * nstatev + ind_num_evals] > max_evals) {
+         hard.push_back(i_pts);
+      }
+   }
+
+   for (int nsub = 2; (nsub <= max_substeps) && !hard.empty(); nsub *= 2) {
+      const int n_hard = hard.size();
+      const double dt_sub = dt / nsub;
+
+      // Gather the beginning time step values for the points
+      for (int i_hard = 0; i_hard < n_hard; i_hard++) {
+         const int i_pts = hard[i_hard];
+         double* state_vars = &(state_vars_scr[i_hard * nstatev]);
+         for (int i = 0; i < nstatev; i++) {
+            state_vars[i] = beg_state_vars_view(i, ipts_offset + i_pts);
+         }
+         for (int i = 0; i < ecmech::ne; i++) {
+            eng_int_scr[i_hard * ecmech::ne + i] = state_vars[ind_int_eng + i];
+         }
+         const double* stress = &(stress_array[i_pts * ecmech::nsvec]);
+         double* stress_svec_p = &(stress_svec_p_scr[i_hard * ecmech::nsvp]);
+         const double stress_mean = -ecmech::onethird * (stress[0] + stress[1] + stress[2]);
+         for (int i = 0; i < ecmech::nsvec; i++) {
+            stress_svec_p[i] = stress[i];
+         }
+         stress_svec_p[0] += stress_mean;
+         stress_svec_p[1] += stress_mean;
+         stress_svec_p[2] += stress_mean;
+         stress_svec_p[ecmech::iSvecP] = stress_mean;
+         std::copy_n(&d_svec_p_array[i_pts * ecmech::nsvp], ecmech::nsvp, &d_svec_p_scr[i_hard * ecmech::nsvp]);
+         std::copy_n(&w_vec_array[i_pts * ecmech::nwvec], ecmech::nwvec, &w_vec_scr[i_hard * ecmech::nwvec]);
+         tempk_scr[i_hard] = tempk_array[i_pts];
+         // This gets shifted over to the beginning volume ratio for the 1st sub-increment
+         vol_ratio_scr[i_hard * ecmech::nvr + 1] = state_vars[ind_vols];
+      }
+
+      // The flow strength is summed over the sub-increments, so that the plastic
+      // work calculated in the post-processing stage is the sum over the sub-increments.
+      std::vector<double> flow_str(n_hard, 0.0);
+      std::vector<double> tot_evals(n_hard, 0.0);
+      std::vector<double> max_sub_evals(n_hard, 0.0);
+
+      for (int isub = 0; isub < nsub; isub++) {
+         for (int i_hard = 0; i_hard < n_hard; i_hard++) {
+            double* vol_ratio = &(vol_ratio_scr[i_hard * ecmech::nvr]);
+            vol_ratio[0] = vol_ratio[1];
+            vol_ratio[1] = vol_ratio[0] * exp(d_svec_p_scr[i_hard * ecmech::nsvp + ecmech::iSvecP] * dt_sub);
+            vol_ratio[3] = vol_ratio[1] - vol_ratio[0];
+            vol_ratio[2] = vol_ratio[3] / (dt_sub * 0.5 * (vol_ratio[0] + vol_ratio[1]));
+         }
+
+         kernel(mat_model_base, n_hard, dt_sub, state_vars_scr,
+                stress_svec_p_scr, d_svec_p_scr, w_vec_scr,
+                ddsdde_scr, vol_ratio_scr, eng_int_scr,
+                tempk_scr, sdd_scr);
+
+         for (int i_hard = 0; i_hard < n_hard; i_hard++) {
+            const double* state_vars = &(state_vars_scr[i_hard * nstatev]);
+            flow_str[i_hard] += state_vars[ind_pl_work];
+            tot_evals[i_hard] += state_vars[ind_num_evals];
+            max_sub_evals[i_hard] = std::max(max_sub_evals[i_hard], state_vars[ind_num_evals]);
+         }
+      }
+
+      // Scatter the outputs back to their original points and find out which
+      // points still need further sub-stepping
+      std::vector<int> still_hard;
+      for (int i_hard = 0; i_hard < n_hard; i_hard++) {
+         const int i_pts = hard[i_hard];
+         double* state_vars = &(state_vars_scr[i_hard * nstatev]);
+         state_vars[ind_pl_work] = flow_str[i_hard] / nsub;
+         state_vars[ind_num_evals] = tot_evals[i_hard];
+         std::copy_n(state_vars, nstatev, &state_vars_array[i_pts * nstatev]);
+         std::copy_n(&stress_svec_p_scr[i_hard * ecmech::nsvp], ecmech::nsvp, &stress_svec_p_array[i_pts * ecmech::nsvp]);
+         std::copy_n(&eng_int_scr[i_hard * ecmech::ne], ecmech::ne, &eng_int_array[i_pts * ecmech::ne]);
+         std::copy_n(&ddsdde_scr[i_hard * nddsdde], nddsdde, &ddsdde_array[i_pts * nddsdde]);
+         std::copy_n(&sdd_scr[i_hard * ecmech::nsdd], ecmech::nsdd, &sdd_array[i_pts * ecmech::nsdd]);
+         vol_ratio_array[i_pts * ecmech::nvr + 1] = vol_ratio_scr[i_hard * ecmech::nvr + 1];
+         if (max_sub_evals[i_hard] > max_evals) {
+            still_hard.push_back(i_pts);
+         }
+      }
+      hard.swap(still_hard);
+   }
+}
+
 } // End private namespace
 
 // Our model set-up makes use of several preprocessing kernels,
 // the actual material model kernel, and finally a post-processing kernel.
+// All of these stages are run over blocks of elements at a time, so the temporary
+// arrays passed between the stages only need to hold a single block of points
+// and can stay resident in cache between stages. By default a single block
+// contains all of the elements. When dynamic scheduling is turned on, the blocks
+// are instead handed out to the OpenMP threads as they finish their previous block.
 void ExaCMechModel::ModelSetup(const int nqpts, const int nelems, const int /*space_dim*/,
                                const int nnodes, const Vector &jacobian,
                                const Vector &loc_grad, const Vector &vel)
@@ -193,60 +408,173 @@ void ExaCMechModel::ModelSetup(const int nqpts, const int nelems, const int /*sp
    const double *loc_grad_array = loc_grad.Read();
    const double *vel_array = vel.Read();
 
-   // Here we call an initialization function which sets the end step stress
-   // and state variable variables to the initial time step values.
-   // Then the pointer to the underlying data array is returned and
-   // operated on to those end time step variables
-   double* state_vars_array = StateVarsSetup();
+   // We read the beginning time step stress and state variables directly and
+   // only ever write the end time step values. Every point's end time step values
+   // and material tangent stiffness matrix are completely overwritten, so we don't
+   // need to copy or zero anything out ahead of time.
    const double *state_vars_beg = matVars0->Read();
-   double* stress_array = StressSetup();
+   double* state_vars_array = matVars1->Write();
+   const double *stress_beg = stress0->Read();
+   double* stress_array = stress1->Write();
    // If we require a 4D tensor for PA applications then we might
    // need to use something other than this for our applications.
+   // The elastic screening makes use of each point's previous material tangent stiffness matrix,
+   // so it needs to be retained in that case.
    QuadratureFunction* matGrad_qf = matGrad;
-   *matGrad_qf = 0.0;
-   double* ddsdde_array = matGrad_qf->ReadWrite();
+   double* ddsdde_array = (screen_frac > 0.0) ? matGrad_qf->ReadWrite() : matGrad_qf->Write();
    // All of these variables are stored on the material model class using
-   // the vector class.
-   *vel_grad_array = 0.0;
-   double* vel_grad_array_data = vel_grad_array->ReadWrite();
-   double* stress_svec_p_array_data = stress_svec_p_array->ReadWrite();
-   double* d_svec_p_array_data = d_svec_p_array->ReadWrite();
-   double* w_vec_array_data = w_vec_array->ReadWrite();
-   double* vol_ratio_array_data = vol_ratio_array->ReadWrite();
-   double* eng_int_array_data = eng_int_array->ReadWrite();
-   double* tempk_array_data = tempk_array->ReadWrite();
-   double* sdd_array_data = sdd_array->ReadWrite();
-
-   const int npts = nqpts * nelems;
-   double dEff;
-
-   // If we're on the initial step we need to first calculate a
-   // solution where our vgrad is the 0 tensor across the entire
-   // body. After we obtain this we calculate our actual velocity
-   // gradient and use that to obtain the appropriate stress field
-   // but don't calculate the material tangent stiffness tensor.
-   // Any other step is much simpler, and we just calculate the
-   // velocity gradient, run our model, and then obtain our material
-   // tangent stiffness matrix.
-   CALI_MARK_BEGIN("ecmech_setup");
-   exaconstit::kernel::grad_calc(nqpts, nelems, nnodes, jacobian_array, loc_grad_array,
-                                 vel_array, vel_grad_array_data);
-
-   kernel_setup(npts, nstatev, dt, temp_k, vel_grad_array_data,
-                stress_array, state_vars_array, stress_svec_p_array_data,
-                d_svec_p_array_data, w_vec_array_data,
-                vol_ratio_array_data, eng_int_array_data, tempk_array_data, &dEff);
-   CALI_MARK_END("ecmech_setup");
-   CALI_MARK_BEGIN("ecmech_kernel");
-   kernel(mat_model_base, npts, dt, state_vars_array,
-            stress_svec_p_array_data, d_svec_p_array_data, w_vec_array_data,
-            ddsdde_array, vol_ratio_array_data, eng_int_array_data,
-            tempk_array_data, sdd_array_data);
-   CALI_MARK_END("ecmech_kernel");
-
-   CALI_MARK_BEGIN("ecmech_postprocessing");
-   kernel_postprocessing(npts, nstatev, dt, dEff, stress_svec_p_array_data,
-                         vol_ratio_array_data, eng_int_array_data, state_vars_beg, state_vars_array,
-                         stress_array, ddsdde_array);
-   CALI_MARK_END("ecmech_postprocessing");
-} // End of ModelSetup function
\ No newline at end of file
+   // the vector class. They are completely overwritten for each block of points,
+   // so we only ever need write access to them.
+   double* vel_grad_array_data = vel_grad_array->Write();
+   double* stress_svec_p_array_data = stress_svec_p_array->Write();
+   double* d_svec_p_array_data = d_svec_p_array->Write();
+   double* w_vec_array_data = w_vec_array->Write();
+   double* vol_ratio_array_data = vol_ratio_array->Write();
+   double* eng_int_array_data = eng_int_array->Write();
+   double* tempk_array_data = tempk_array->Write();
+   double* sdd_array_data = sdd_array->Write();
+   // ExaCMech requires all of the state variables for a point to be next to each other.
+   // So if they're stored in a structure of arrays format, a block's worth of them
+   // are gathered into a scratch array which ExaCMech then operates on.
+   double* state_vars_scr_data = soa_state_vars ? state_vars_scr_array->Write() : nullptr;
+   const RAJA::Layout<2> state_vars_layout = GetStateVarsLayout();
+   // The flags for which points are elastic followed by the compacted material model
+   // inputs and outputs for the points that are either not elastic or being sub-stepped.
+   double* compact_scr_data = (compact_scr_array != nullptr) ? compact_scr_array->HostReadWrite() : nullptr;
+   const int compact_scr_size = 1 + nstatev + 2 * ecmech::nsvp + ecmech::nwvec
+                               + ecmech::nsvec * ecmech::nsvec + ecmech::nvr + ecmech::ne + 1 + ecmech::nsdd;
+
+   const int nelems_chunk = std::max(1, chunk_elems);
+   const int nblks = (nelems + nelems_chunk - 1) / nelems_chunk;
+   // Number of points in a full block which is also the stride between
+   // each thread's portion of the scratch arrays
+   const int npts_chunk = nqpts * nelems_chunk;
+
+   // Runs all of our stages over a single block of elements using the
+   // scratch space owned by the provided thread.
+   auto run_block = [&](const int iblk, const int ithread) {
+      const int ielem = iblk * nelems_chunk;
+      const int nelems_blk = std::min(nelems_chunk, nelems - ielem);
+      const int npts = nqpts * nelems_blk;
+      // Offset of the first point in this block
+      const int ipts = nqpts * ielem;
+      // Offset of the first point in this thread's scratch space
+      const int iscr = npts_chunk * ithread;
+
+      // Our pointers to the global arrays for this block of points
+      const double* jacobian_blk = &(jacobian_array[ipts * ecmech::ndim * ecmech::ndim]);
+      const double* vel_blk = &(vel_array[ielem * nnodes * ecmech::ndim]);
+      const double* stress_beg_blk = &(stress_beg[ipts * ecmech::nsvec]);
+      double* stress_blk = &(stress_array[ipts * ecmech::nsvec]);
+      double* ddsdde_blk = &(ddsdde_array[ipts * ecmech::nsvec * ecmech::nsvec]);
+      // Our pointers to the scratch space
+      double* vel_grad_scr = &(vel_grad_array_data[iscr * ecmech::ndim * ecmech::ndim]);
+      double* stress_svec_p_scr = &(stress_svec_p_array_data[iscr * ecmech::nsvp]);
+      double* d_svec_p_scr = &(d_svec_p_array_data[iscr * ecmech::nsvp]);
+      double* w_vec_scr = &(w_vec_array_data[iscr * ecmech::nwvec]);
+      double* vol_ratio_scr = &(vol_ratio_array_data[iscr * ecmech::nvr]);
+      double* eng_int_scr = &(eng_int_array_data[iscr * ecmech::ne]);
+      double* tempk_scr = &(tempk_array_data[iscr]);
+      double* sdd_scr = &(sdd_array_data[iscr * ecmech::nsdd]);
+      // The state variables that ExaCMech works on
+      double* state_vars_blk = soa_state_vars ? &(state_vars_scr_data[iscr * nstatev])
+                               : &(state_vars_array[ipts * nstatev]);
+
+      CALI_MARK_BEGIN("ecmech_setup");
+      exaconstit::kernel::grad_calc(nqpts, nelems_blk, nnodes, jacobian_blk, loc_grad_array,
+                                    vel_blk, vel_grad_scr);
+
+      kernel_setup(npts, nstatev, dt, temp_k, vel_grad_scr,
+                   stress_beg_blk, state_vars_beg, state_vars_layout, ipts,
+                   state_vars_blk, stress_svec_p_scr,
+                   d_svec_p_scr, w_vec_scr,
+                   vol_ratio_scr, eng_int_scr, tempk_scr);
+      CALI_MARK_END("ecmech_setup");
+      if (screen_frac > 0.0) {
+         double* elastic_scr = &(compact_scr_data[iscr * compact_scr_size]);
+         CALI_MARK_BEGIN("ecmech_screen");
+         ScreenElasticPoints(npts, nstatev, d_svec_p_scr, w_vec_scr, vol_ratio_scr,
+                             stress_svec_p_scr, eng_int_scr, state_vars_blk,
+                             ddsdde_blk, elastic_scr);
+         CALI_MARK_END("ecmech_screen");
+         CALI_MARK_BEGIN("ecmech_kernel");
+         kernel_screened(mat_model_base, npts, nstatev, dt, elastic_scr, &(elastic_scr[npts]),
+                         state_vars_blk, stress_svec_p_scr, d_svec_p_scr, w_vec_scr,
+                         ddsdde_blk, vol_ratio_scr, eng_int_scr,
+                         tempk_scr, sdd_scr);
+         CALI_MARK_END("ecmech_kernel");
+      }
+      else {
+         CALI_MARK_BEGIN("ecmech_kernel");
+         kernel(mat_model_base, npts, dt, state_vars_blk,
+                stress_svec_p_scr, d_svec_p_scr, w_vec_scr,
+                ddsdde_blk, vol_ratio_scr, eng_int_scr,
+                tempk_scr, sdd_scr);
+         CALI_MARK_END("ecmech_kernel");
+      }
+
+      if (substep_evals > 0) {
+         CALI_MARK_BEGIN("ecmech_substep");
+         kernel_substep(mat_model_base, npts, nstatev, dt, max_substeps, substep_evals,
+                        stress_beg_blk, state_vars_beg, state_vars_layout, ipts,
+                        &(compact_scr_data[iscr * compact_scr_size + npts]),
+                        state_vars_blk, stress_svec_p_scr, d_svec_p_scr, w_vec_scr,
+                        ddsdde_blk, vol_ratio_scr, eng_int_scr,
+                        tempk_scr, sdd_scr);
+         CALI_MARK_END("ecmech_substep");
+      }
+
+      CALI_MARK_BEGIN("ecmech_postprocessing");
+      kernel_postprocessing(npts, nstatev, dt, d_svec_p_scr, stress_svec_p_scr,
+                            vol_ratio_scr, eng_int_scr, state_vars_beg,
+                            state_vars_array, state_vars_layout, ipts, soa_state_vars,
+                            state_vars_blk, stress_blk, ddsdde_blk);
+      CALI_MARK_END("ecmech_postprocessing");
+   };
+
+   if (!dyn_sched) {
+      for (int iblk = 0; iblk < nblks; iblk++) {
+         run_block(iblk, 0);
+      }
+      return;
+   }
+
+   // The cost of a point is dominated by the number of evaluations the
+   // nonlinear solve within ExaCMech takes. So, we can use the number of
+   // evaluations each point took in the previous time step to hand out the
+   // most expensive blocks first, which keeps threads from sitting idle at the end.
+   std::vector<int> blk_order(nblks);
+   for (int iblk = 0; iblk < nblks; iblk++) {
+      blk_order[iblk] = iblk;
+   }
+
+   if (cost_sort) {
+      const int ind_num_evals = ecmech::evptn::iHistA_nFEval;
+      RAJA::View<const double, RAJA::Layout<2> > state_vars_beg_h(matVars0->HostRead(), state_vars_layout);
+      std::vector<double> blk_cost(nblks, 0.0);
+      for (int iblk = 0; iblk < nblks; iblk++) {
+         const int ipts_beg = iblk * npts_chunk;
+         const int ipts_end = std::min(ipts_beg + npts_chunk, nqpts * nelems);
+         for (int ipts = ipts_beg; ipts < ipts_end; ipts++) {
+            blk_cost[iblk] += state_vars_beg_h(ind_num_evals, ipts);
+         }
+      }
+      std::stable_sort(blk_order.begin(), blk_order.end(),
+                       [&blk_cost](const int a, const int b) { return blk_cost[a] > blk_cost[b]; });
+   }
+
+   // Each thread runs a block at a time serially. The MFEM_FORALL / RAJA kernels within
+   // the stages open their own parallel regions, so nested parallelism is turned off
+   // while the blocks are running. Otherwise, those regions could each spin up a full team
+   // of threads (OMP_MAX_ACTIVE_LEVELS > 1 or a nested OMP_NUM_THREADS list) and
+   // oversubscribe the node.
+#if defined(RAJA_ENABLE_OPENMP)
+   const int max_active_levels = omp_get_max_active_levels();
+   omp_set_max_active_levels(1);
+   #pragma omp parallel for schedule(dynamic, 1)
+   for (int i = 0; i < nblks; i++) {
+      run_block(blk_order[i], omp_get_thread_num());
+   }
+   omp_set_max_active_levels(max_active_levels);
+#endif
+} // End of ModelSetup function
@@ -7,6 +7,12 @@
 #include "ECMech_evptnWrap.h"
 #include "ECMech_const.h"
 #include "mechanics_model.hpp"
+#include "RAJA/RAJA.hpp"
+
+#include <algorithm>
+#if defined(RAJA_ENABLE_OPENMP)
+#include <omp.h>
+#endif
 
 /// Base class for all of our ExaCMechModels.
 class ExaCMechModel : public ExaModel
@@ -25,8 +31,21 @@ class ExaCMechModel : public ExaModel
       // Our accelartion that we are making use of.
       ecmech::ExecutionStrategy accel;
 
+      // The number of elements whose quadrature points are run through the
+      // setup, material model, and post-processing stages as a single block.
+      int chunk_elems;
+
+      // Whether or not the blocks of points are handed out dynamically to the
+      // OpenMP threads, and if so whether the most expensive blocks from the
+      // previous time step are handed out first.
+      bool dyn_sched;
+      bool cost_sort;
+      // Number of threads we have scratch space for
+      int nthreads;
+
       // Temporary variables that we'll be making use of when running our
-      // models.
+      // models. These are only sized for a single block of points per thread,
+      // so they're just scratch space that's reused for every block.
       mfem::Vector *vel_grad_array;
       mfem::Vector *eng_int_array;
       mfem::Vector *w_vec_array;
@@ -35,6 +54,22 @@ class ExaCMechModel : public ExaModel
       mfem::Vector *d_svec_p_array;
       mfem::Vector *tempk_array;
       mfem::Vector *sdd_array;
+      // Only used if the state variables are stored in a structure of arrays format
+      mfem::Vector *state_vars_scr_array;
+
+      // Points whose resolved shear stresses stay below this fraction of their
+      // hardness take a closed-form elastic update rather than going through
+      // the material model. A value of 0 turns off the screening.
+      double screen_frac;
+      // Points whose nonlinear solve takes more than substep_evals evaluations are
+      // re-integrated over up to max_substeps sub-increments of the time step.
+      // A value of 0 for substep_evals turns off the sub-stepping.
+      int max_substeps;
+      int substep_evals;
+      // Only used if the elastic screening or sub-stepping is turned on. This holds
+      // a flag for each point on whether it was screened out, and compacted copies
+      // of all of the material model inputs/outputs for a subset of the points.
+      mfem::Vector *compact_scr_array;
 
    public:
       ExaCMechModel(mfem::QuadratureFunction *_q_stress0, mfem::QuadratureFunction *_q_stress1,
@@ -42,15 +77,49 @@ class ExaCMechModel : public ExaModel
                     mfem::QuadratureFunction *_q_matVars1,
                     mfem::ParGridFunction* _beg_coords, mfem::ParGridFunction* _end_coords,
                     mfem::Vector *_props, int _nProps, int _nStateVars, double _temp_k,
-                    ecmech::ExecutionStrategy _accel, bool _PA) :
+                    ecmech::ExecutionStrategy _accel, bool _PA, int _chunk_size = 0,
+                    bool _dyn_sched = false, bool _cost_sort = false, bool _soa_state_vars = false,
+                    double _screen_frac = 0.0, int _max_substeps = 1, int _substep_evals = 0) :
          ExaModel(_q_stress0, _q_stress1, _q_matGrad, _q_matVars0, _q_matVars1,
                   _beg_coords, _end_coords, _props, _nProps, _nStateVars, _PA),
-         temp_k(_temp_k), accel(_accel)
+         temp_k(_temp_k), accel(_accel), dyn_sched(false), cost_sort(_cost_sort), nthreads(1),
+         state_vars_scr_array(nullptr), screen_frac(_screen_frac),
+         max_substeps(_max_substeps), substep_evals(0), compact_scr_array(nullptr)
       {
+         MFEM_VERIFY(!(screen_frac > 0.0 && accel == ecmech::ExecutionStrategy::CUDA),
+                     "The elastic screening of points is only available on the host");
+         if (max_substeps > 1) {
+            substep_evals = _substep_evals;
+         }
+         MFEM_VERIFY(!(substep_evals > 0 && accel == ecmech::ExecutionStrategy::CUDA),
+                     "The sub-stepping of points is only available on the host");
+         soa_state_vars = _soa_state_vars;
+         // Dynamic scheduling only makes sense when we're running with OpenMP.
+         // In that mode, each thread runs its own blocks serially.
+#if defined(RAJA_ENABLE_OPENMP)
+         if (_dyn_sched && (accel == ecmech::ExecutionStrategy::OPENMP)) {
+            dyn_sched = true;
+            nthreads = omp_get_max_threads();
+         }
+#endif
          // First find the total number of points that we're dealing with so nelems * nqpts
          const int vdim = _q_stress0->GetVDim();
          const int size = _q_stress0->Size();
-         const int npts = size / vdim;
+         const int nqpts = _q_stress0->GetSpace()->GetElementIntRule(0).GetNPoints();
+         const int nelems = size / (vdim * nqpts);
+         // A chunk size of 0 or less means all of the points are processed at once.
+         // Otherwise, we round the chunk size down to a whole number of elements
+         // so the velocity gradient can also be calculated a block at a time.
+         chunk_elems = nelems;
+         if (_chunk_size > 0) {
+            chunk_elems = std::max(1, std::min(nelems, _chunk_size / nqpts));
+         }
+         else if (dyn_sched) {
+            // If no chunk size was given we aim for roughly 8 blocks per thread
+            // which gives the scheduler something to balance with.
+            chunk_elems = std::max(1, nelems / (8 * nthreads));
+         }
+         const int npts = chunk_elems * nqpts * nthreads;
          // Now initialize all of the vectors that we'll be using with our class
          vel_grad_array = new mfem::Vector(npts * ecmech::ndim * ecmech::ndim, mfem::Device::GetMemoryType());
          eng_int_array = new mfem::Vector(npts * ecmech::ne, mfem::Device::GetMemoryType());
@@ -71,6 +140,16 @@ class ExaCMechModel : public ExaModel
          d_svec_p_array->UseDevice(true); *d_svec_p_array = 0.0;
          tempk_array->UseDevice(true); *tempk_array = 0.0;
          sdd_array->UseDevice(true); *sdd_array = 0.0;
+         if (soa_state_vars) {
+            state_vars_scr_array = new mfem::Vector(npts * _q_matVars0->GetVDim(), mfem::Device::GetMemoryType());
+            state_vars_scr_array->UseDevice(true); *state_vars_scr_array = 0.0;
+         }
+         if ((screen_frac > 0.0) || (substep_evals > 0)) {
+            const int scr_size = 1 + _q_matVars0->GetVDim() + 2 * ecmech::nsvp + ecmech::nwvec
+                                 + ecmech::nsvec * ecmech::nsvec + ecmech::nvr + ecmech::ne + 1 + ecmech::nsdd;
+            compact_scr_array = new mfem::Vector(npts * scr_size);
+            *compact_scr_array = 0.0;
+         }
       }
 
       virtual ~ExaCMechModel()
@@ -83,6 +162,8 @@ class ExaCMechModel : public ExaModel
          delete d_svec_p_array;
          delete tempk_array;
          delete sdd_array;
+         delete state_vars_scr_array;
+         delete compact_scr_array;
       }
 
       /** This model takes in the velocity, det(jacobian), and local_grad/jacobian.
@@ -100,6 +181,21 @@ class ExaCMechModel : public ExaModel
       virtual void UpdateModelVars(){}
 
       virtual void calcDpMat(mfem::QuadratureFunction &DpMat) const = 0;
+
+      /** @brief Screens out the points within a block that stay safely elastic.
+       *
+       *  A point is considered elastic if the resolved shear stresses from both its
+       *  beginning time step stress and its trial elastic stress are below screen_frac
+       *  times its hardness. Those points have their stress, state variables, and
+       *  internal energy updated using a closed-form elastic update with the material tangent
+       *  stiffness matrix from the point's last evaluation, and they're flagged
+       *  in elastic_array. All of the arrays are in the formats passed to ExaCMech.
+       */
+      virtual void ScreenElasticPoints(const int npts, const int nstatev,
+                                       const double* d_svec_p_array, const double* w_vec_array,
+                                       const double* vol_ratio_array, double* stress_svec_p_array,
+                                       double* eng_int_array, double* state_vars_array,
+                                       double* ddsdde_array, double* elastic_array) const = 0;
 };
 
 /// A generic templated class that takes in a typedef of the crystal model that
@@ -124,10 +220,13 @@ class ECMechXtalModel : public ExaCMechModel
                       mfem::QuadratureFunction *_q_matVars1,
                       mfem::ParGridFunction* _beg_coords, mfem::ParGridFunction* _end_coords,
                       mfem::Vector *_props, int _nProps, int _nStateVars, double _temp_k,
-                      ecmech::ExecutionStrategy _accel, bool _PA) :
+                      ecmech::ExecutionStrategy _accel, bool _PA, int _chunk_size = 0,
+                      bool _dyn_sched = false, bool _cost_sort = false, bool _soa_state_vars = false,
+                      double _screen_frac = 0.0, int _max_substeps = 1, int _substep_evals = 0) :
          ExaCMechModel(_q_stress0, _q_stress1, _q_matGrad, _q_matVars0, _q_matVars1,
                        _beg_coords, _end_coords, _props, _nProps, _nStateVars, _temp_k,
-                       _accel, _PA)
+                       _accel, _PA, _chunk_size, _dyn_sched, _cost_sort, _soa_state_vars,
+                       _screen_frac, _max_substeps, _substep_evals)
       {
          // For FCC material models we have the following state variables
          // and their number of components
@@ -188,6 +287,7 @@ class ECMechXtalModel : public ExaCMechModel
             std::string s_hard = "hardness";
             std::string s_ieng = "int_eng";
             std::string s_rvol = "rel_vol";
+            std::string s_elas = "dev_elas_strain";
 
             std::pair<int, int>  i_sre = std::make_pair(ind_dp_eff, 1);
             std::pair<int, int>  i_se = std::make_pair(ind_eql_pl_strain, 1);
@@ -197,6 +297,7 @@ class ECMechXtalModel : public ExaCMechModel
             std::pair<int, int>  i_h = std::make_pair(ind_hardness, num_hardness);
             std::pair<int, int>  i_en = std::make_pair(ind_int_eng, ecmech::ne);
             std::pair<int, int>  i_rv = std::make_pair(ind_vols, 1);
+            std::pair<int, int>  i_el = std::make_pair(ind_dev_elas_strain, ecmech::ntvec);
 
             qf_mapping[s_shrateEff] = i_sre;
             qf_mapping[s_shrEff] = i_se;
@@ -206,6 +307,7 @@ class ECMechXtalModel : public ExaCMechModel
             qf_mapping[s_hard] = i_h;
             qf_mapping[s_ieng] = i_en;
             qf_mapping[s_rvol] = i_rv;
+            qf_mapping[s_elas] = i_el;
          }
 
          // Opts and strs are just empty vectors of int and strings
@@ -224,7 +326,14 @@ class ECMechXtalModel : public ExaCMechModel
          // We really shouldn't see this change over time at least for our applications.
          mat_model_base->initFromParams(opts, params, strs);
          mat_model_base->complete();
-         mat_model_base->setExecutionStrategy(accel);
+         // When the blocks are dynamically scheduled over the threads each
+         // thread calls the material model serially on its own block.
+         if (dyn_sched) {
+            mat_model_base->setExecutionStrategy(ecmech::ExecutionStrategy::CPU);
+         }
+         else {
+            mat_model_base->setExecutionStrategy(accel);
+         }
 
          std::vector<double> histInit;
          {
@@ -235,6 +344,23 @@ class ECMechXtalModel : public ExaCMechModel
          }
 
          init_state_vars(_q_matVars0, histInit);
+
+         // Everything up to this point has initialized the state variables in
+         // the normal quadrature function format, so we now need to transpose them
+         // over to the structure of arrays format. The end time step values are
+         // always completely overwritten, so they don't need to be transposed.
+         if (soa_state_vars) {
+            const int vdim = _q_matVars0->GetVDim();
+            const int npts = _q_matVars0->Size() / vdim;
+            mfem::Vector aos(*_q_matVars0);
+            const double* aos_data = aos.Read();
+            double* soa_data = _q_matVars0->Write();
+            mfem::MFEM_FORALL(i, npts, {
+               for (int j = 0; j < vdim; j++) {
+                  soa_data[j * npts + i] = aos_data[i * vdim + j];
+               }
+            });
+         }
       }
 
       /// This really shouldn't be used. It's only public due to the internal
@@ -283,7 +409,9 @@ class ECMechXtalModel : public ExaCMechModel
          auto slip_geom = mat_model->getSlipGeom();
          const int ind_slip = ind_gdot;
          const int npts = DpMat.GetSpace()->GetSize();
-         auto gdot = mfem::Reshape(matVars1->Read(), matVars1->GetVDim(), npts);
+         // The state variables aren't necessarily contiguous for a point, so they're
+         // accessed through the state variable layout.
+         RAJA::View<const double, RAJA::Layout<2> > state_vars(matVars1->Read(), GetStateVarsLayout());
          auto d_dpmat = mfem::Reshape(DpMat.Write(), 3, 3, npts);
 
          MFEM_ASSERT(DpMat.GetVDim() == 9, "DpMat needs to have a vdim of 9");
@@ -294,19 +422,23 @@ class ECMechXtalModel : public ExaCMechModel
             for (int idvec = 0; idvec < ecmech::ntvec; idvec++) {
                dphat[idvec] = 0.0;
             }
+            double gdot[slip_geom.nslip];
+            for (int islip = 0; islip < slip_geom.nslip; islip++) {
+               gdot[islip] = state_vars(ind_slip + islip, ipts);
+            }
             // Compute dphat in the crystal frame
-            ecmech::vecsVMa<ecmech::ntvec, slip_geom.nslip>(dphat, slip_geom.getP(), &gdot(ind_slip, ipts));
+            ecmech::vecsVMa<ecmech::ntvec, slip_geom.nslip>(dphat, slip_geom.getP(), gdot);
 
             // Calculated D^p in the crystal frame so we need to rotate things
             // back to the sample frame now
             double rot_mat[ecmech::ndim * ecmech::ndim];
 
-            // double quat[ecmech::qdim];
-            // quat[0] = gdot(ind_quats, ipts);
-            // quat[1] = gdot(ind_quats + 1, ipts);
-            // quat[2] = gdot(ind_quats + 2, ipts);
-            // quat[3] = gdot(ind_quats + 3, ipts);
-            ecmech::quat_to_tensor(rot_mat, &gdot(ind_quats, ipts));
+            double quat[ecmech::qdim];
+            quat[0] = state_vars(ind_quats, ipts);
+            quat[1] = state_vars(ind_quats + 1, ipts);
+            quat[2] = state_vars(ind_quats + 2, ipts);
+            quat[3] = state_vars(ind_quats + 3, ipts);
+            ecmech::quat_to_tensor(rot_mat, quat);
             //
             double qr5x5_ls[ecmech::ntvec * ecmech::ntvec];
             ecmech::get_rot_mat_vecd(qr5x5_ls, rot_mat);
@@ -332,6 +464,195 @@ class ECMechXtalModel : public ExaCMechModel
          });
       }
 
+      // The elastic update here is a forward Euler hypoelastic update that makes use
+      // of the material tangent stiffness matrix from the last time the point was run
+      // through the material model. So, it's only a good approximation when the points
+      // are well within the elastic regime which is what the screening tolerance controls.
+      virtual void ScreenElasticPoints(const int npts, const int nstatev,
+                                       const double* d_svec_p_array, const double* w_vec_array,
+                                       const double* vol_ratio_array, double* stress_svec_p_array,
+                                       double* eng_int_array, double* state_vars_array,
+                                       double* ddsdde_array, double* elastic_array) const override
+      {
+         auto slip_geom = mat_model->getSlipGeom();
+         const double dt_loc = dt;
+         const double frac = screen_frac;
+         const int ind_slip = ind_gdot;
+         const int ind_srate = ind_dp_eff;
+         const int ind_plw = ind_pl_work;
+         const int ind_nevals = ind_num_evals;
+         const int ind_elas = ind_dev_elas_strain;
+         const int ind_q = ind_quats;
+         const int ind_h = ind_hardness;
+
+         mfem::MFEM_FORALL(ipts, npts, {
+            double* state_vars = &(state_vars_array[ipts * nstatev]);
+            double* stress_svec_p = &(stress_svec_p_array[ipts * ecmech::nsvp]);
+            double* ddsdde = &(ddsdde_array[ipts * ecmech::nsvec * ecmech::nsvec]);
+            const double* d_svec_p = &(d_svec_p_array[ipts * ecmech::nsvp]);
+            const double* w_vec = &(w_vec_array[ipts * ecmech::nwvec]);
+            const double* vol_ratio = &(vol_ratio_array[ipts * ecmech::nvr]);
+
+            elastic_array[ipts] = 0.0;
+            // This point has never been run through the material model,
+            // so we don't have a material tangent stiffness matrix to use yet.
+            if (ddsdde[0] <= 0.0) { return; }
+
+            // Beginning time step Cauchy stress in Voigt notation
+            double sig0[ecmech::nsvec];
+            for (int i = 0; i < 3; i++) {
+               sig0[i] = stress_svec_p[i] - stress_svec_p[ecmech::iSvecP];
+               sig0[i + 3] = stress_svec_p[i + 3];
+            }
+            // The strain increment in Voigt notation with engineering shear strains
+            double deps[ecmech::nsvec];
+            for (int i = 0; i < 3; i++) {
+               deps[i] = dt_loc * (d_svec_p[i] + ecmech::onethird * d_svec_p[ecmech::iSvecP]);
+               deps[i + 3] = 2.0 * dt_loc * d_svec_p[i + 3];
+            }
+            // Trial stress from the material tangent stiffness matrix, which is stored as
+            // ddsdde[i + 6 j] = C_ij, and the rotation of the stress by the spin
+            double sig1[ecmech::nsvec];
+            for (int i = 0; i < ecmech::nsvec; i++) {
+               sig1[i] = sig0[i];
+               for (int j = 0; j < ecmech::nsvec; j++) {
+                  sig1[i] += ddsdde[i + ecmech::nsvec * j] * deps[j];
+               }
+            }
+            {
+               // W sig - sig W in Voigt notation
+               const double s[3][3] = {{ sig0[0], sig0[5], sig0[4] },
+                                       { sig0[5], sig0[1], sig0[3] },
+                                       { sig0[4], sig0[3], sig0[2] } };
+               const double w[3][3] = {{ 0.0, -w_vec[2], w_vec[1] },
+                                       { w_vec[2], 0.0, -w_vec[0] },
+                                       { -w_vec[1], w_vec[0], 0.0 } };
+               double ws[3][3];
+               for (int i = 0; i < 3; i++) {
+                  for (int j = 0; j < 3; j++) {
+                     ws[i][j] = 0.0;
+                     for (int k = 0; k < 3; k++) {
+                        ws[i][j] += w[i][k] * s[k][j] - s[i][k] * w[k][j];
+                     }
+                  }
+               }
+               sig1[0] += dt_loc * ws[0][0];
+               sig1[1] += dt_loc * ws[1][1];
+               sig1[2] += dt_loc * ws[2][2];
+               sig1[3] += dt_loc * ws[1][2];
+               sig1[4] += dt_loc * ws[0][2];
+               sig1[5] += dt_loc * ws[0][1];
+            }
+
+            // Rotation from the lattice frame to the sample frame
+            double quat[ecmech::qdim];
+            for (int i = 0; i < ecmech::qdim; i++) {
+               quat[i] = state_vars[ind_q + i];
+            }
+            double rot_mat[ecmech::ndim * ecmech::ndim];
+            ecmech::quat_to_tensor(rot_mat, quat);
+            double qr5x5_ls[ecmech::ntvec * ecmech::ntvec];
+            ecmech::get_rot_mat_vecd(qr5x5_ls, rot_mat);
+
+            // Resolved shear stresses for both the beginning and trial stresses
+            const double crss = frac * state_vars[ind_h];
+            bool elastic = true;
+            for (int istress = 0; istress < 2; istress++) {
+               const double* sig = (istress == 0) ? sig0 : sig1;
+               double sig_vecd_sm[ecmech::ntvec];
+               ecmech::svecToVecd(sig_vecd_sm, sig);
+               double sig_vecd_lat[ecmech::ntvec];
+               for (int i = 0; i < ecmech::ntvec; i++) {
+                  sig_vecd_lat[i] = 0.0;
+                  for (int j = 0; j < ecmech::ntvec; j++) {
+                     sig_vecd_lat[i] += qr5x5_ls[j * ecmech::ntvec + i] * sig_vecd_sm[j];
+                  }
+               }
+               const double* P = slip_geom.getP();
+               for (int islip = 0; islip < slip_geom.nslip; islip++) {
+                  double rss = 0.0;
+                  for (int k = 0; k < ecmech::ntvec; k++) {
+                     rss += P[k * slip_geom.nslip + islip] * sig_vecd_lat[k];
+                  }
+                  if (fabs(rss) >= crss) { elastic = false; }
+               }
+            }
+            if (!elastic) { return; }
+
+            elastic_array[ipts] = 1.0;
+
+            // The internal energy makes use of the average stress over the time step
+            for (int i = 0; i < ecmech::nsvec; i++) {
+               eng_int_array[ipts * ecmech::ne] += 0.25 * (vol_ratio[0] + vol_ratio[1])
+                                                   * (sig0[i] + sig1[i]) * deps[i];
+            }
+
+            // Back to the deviatoric + pressure format that ExaCMech uses
+            const double sig1_mean = -ecmech::onethird * (sig1[0] + sig1[1] + sig1[2]);
+            for (int i = 0; i < 3; i++) {
+               stress_svec_p[i] = sig1[i] + sig1_mean;
+               stress_svec_p[i + 3] = sig1[i + 3];
+            }
+            stress_svec_p[ecmech::iSvecP] = sig1_mean;
+
+            // The deviatoric elastic strain lives in the lattice frame
+            {
+               double d_vecd_sm[ecmech::ntvec];
+               ecmech::svecToVecd(d_vecd_sm, d_svec_p);
+               for (int i = 0; i < ecmech::ntvec; i++) {
+                  double d_lat = 0.0;
+                  for (int j = 0; j < ecmech::ntvec; j++) {
+                     d_lat += qr5x5_ls[j * ecmech::ntvec + i] * d_vecd_sm[j];
+                  }
+                  state_vars[ind_elas + i] += dt_loc * d_lat;
+               }
+            }
+
+            // With no plastic spin the lattice rotates with the spin
+            {
+               const double wnorm = sqrt(w_vec[0] * w_vec[0] + w_vec[1] * w_vec[1] + w_vec[2] * w_vec[2]);
+               const double half_th = 0.5 * wnorm * dt_loc;
+               double dq[ecmech::qdim] = { 1.0, 0.0, 0.0, 0.0 };
+               if (wnorm > ecmech::idp_tiny_sqrt) {
+                  const double sfac = sin(half_th) / wnorm;
+                  dq[0] = cos(half_th);
+                  dq[1] = sfac * w_vec[0];
+                  dq[2] = sfac * w_vec[1];
+                  dq[3] = sfac * w_vec[2];
+               }
+               double qnew[ecmech::qdim];
+               qnew[0] = dq[0] * quat[0] - dq[1] * quat[1] - dq[2] * quat[2] - dq[3] * quat[3];
+               qnew[1] = dq[0] * quat[1] + dq[1] * quat[0] + dq[2] * quat[3] - dq[3] * quat[2];
+               qnew[2] = dq[0] * quat[2] - dq[1] * quat[3] + dq[2] * quat[0] + dq[3] * quat[1];
+               qnew[3] = dq[0] * quat[3] + dq[1] * quat[2] - dq[2] * quat[1] + dq[3] * quat[0];
+               const double inv_norm = 1.0 / sqrt(qnew[0] * qnew[0] + qnew[1] * qnew[1]
+                                                  + qnew[2] * qnew[2] + qnew[3] * qnew[3]);
+               for (int i = 0; i < ecmech::qdim; i++) {
+                  state_vars[ind_q + i] = qnew[i] * inv_norm;
+               }
+            }
+
+            // No slip takes place, and the plastic work slot holds the
+            // plastic work rate until the post-processing stage
+            state_vars[ind_srate] = 0.0;
+            state_vars[ind_plw] = 0.0;
+            state_vars[ind_nevals] = 0.0;
+            for (int islip = 0; islip < slip_geom.nslip; islip++) {
+               state_vars[ind_slip + islip] = 0.0;
+            }
+
+            // The post-processing stage transposes the material tangent stiffness
+            // matrix coming out of ExaCMech, so we transpose it here to undo that.
+            for (int i = 0; i < ecmech::nsvec; ++i) {
+               for (int j = i + 1; j < ecmech::nsvec; ++j) {
+                  double tmp = ddsdde[(ecmech::nsvec * j) + i];
+                  ddsdde[(ecmech::nsvec * j) + i] = ddsdde[(ecmech::nsvec * i) + j];
+                  ddsdde[(ecmech::nsvec * i) + j] = tmp;
+               }
+            }
+         });
+      }
+
       virtual ~ECMechXtalModel()
       {
          delete mat_model;
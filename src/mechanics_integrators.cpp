@@ -160,6 +160,7 @@ void ExaNLFIntegrator::AssembleElementGrad(
 void ExaNLFIntegrator::AssemblePA(const FiniteElementSpace &fes)
 {
    CALI_CXX_MARK_SCOPE("enlfi_assemblePA");
+   pa_diag_current = false;
    Mesh *mesh = fes.GetMesh();
    const FiniteElement &el = *fes.GetFE(0);
    space_dims = el.GetDim();
@@ -320,6 +321,7 @@ void ExaNLFIntegrator::AssemblePA(const FiniteElementSpace &fes)
 void ExaNLFIntegrator::AssembleGradPA(const FiniteElementSpace &fes)
 {
    CALI_CXX_MARK_SCOPE("enlfi_assemblePAG");
+   pa_diag_current = false;
    Mesh *mesh = fes.GetMesh();
    const FiniteElement &el = *fes.GetFE(0);
    space_dims = el.GetDim();
@@ -386,11 +388,20 @@ void ExaNLFIntegrator::AssembleGradPA(const FiniteElementSpace &fes)
 
       pa_dmat = 0.0;
 
+      if (pa_diag.Size() != (nnodes * dim * nelems)) {
+         pa_diag.SetSize(nnodes * dim * nelems, mfem::Device::GetMemoryType());
+         pa_diag.UseDevice(true);
+      }
+
+      pa_diag = 0.0;
+
       const int DIM2 = 2;
+      const int DIM3 = 3;
       const int DIM4 = 4;
       const int DIM6 = 6;
       std::array<RAJA::idx_t, DIM6> perm6 {{ 5, 4, 3, 2, 1, 0 } };
       std::array<RAJA::idx_t, DIM4> perm4 {{ 3, 2, 1, 0 } };
+      std::array<RAJA::idx_t, DIM3> perm3 {{ 2, 1, 0 } };
       std::array<RAJA::idx_t, DIM2> perm2 {{ 1, 0 } };
 
       // bunch of helper RAJA views to make dealing with data easier down below in our kernel.
@@ -406,6 +417,14 @@ void ExaNLFIntegrator::AssembleGradPA(const FiniteElementSpace &fes)
 
       RAJA::Layout<DIM2> layout_adj = RAJA::make_permuted_layout({{ dim, dim } }, perm2);
 
+      // The diagonal of our operator is formed at the same time as the D tensor, so
+      // AssembleGradDiagonalPA doesn't need to make another pass over our quadrature data.
+      RAJA::Layout<DIM3> layout_field = RAJA::make_permuted_layout({{ nnodes, dim, nelems } }, perm3);
+      RAJA::View<double, RAJA::Layout<DIM3, RAJA::Index_type, 0> > Ydiag(pa_diag.ReadWrite(), layout_field);
+
+      RAJA::Layout<DIM3> layout_grads = RAJA::make_permuted_layout({{ nnodes, dim, nqpts } }, perm3);
+      RAJA::View<const double, RAJA::Layout<DIM3, RAJA::Index_type, 0> > Gt(grad.Read(), layout_grads);
+
       double dt = model->GetModelDt();
       // This loop we'll want to parallelize the rest are all serial for now.
       MFEM_FORALL(i_elems, nelems, {
@@ -493,8 +512,24 @@ void ExaNLFIntegrator::AssembleGradPA(const FiniteElementSpace &fes)
                   D(i_elems, j_qpts, l, n, 2, 2) *= c_detJ;
                }
             } // End of D_{ijkl} *= 1/det(J) * w_{qpt} loop
+
+            // Diagonal terms of our operator while D is still hot in cache:
+            // diag_{kc} = \nabla_{ka}\phi D_{acci} \nabla_{ki}\phi
+            for (int c = 0; c < dim; c++) {
+               for (int knds = 0; knds < nnodes; knds++) {
+                  double val = 0.0;
+                  for (int a = 0; a < dim; a++) {
+                     val += Gt(knds, a, j_qpts) * (D(i_elems, j_qpts, a, c, c, 0) * Gt(knds, 0, j_qpts) +
+                                                   D(i_elems, j_qpts, a, c, c, 1) * Gt(knds, 1, j_qpts) +
+                                                   D(i_elems, j_qpts, a, c, c, 2) * Gt(knds, 2, j_qpts));
+                  }
+                  Ydiag(knds, c, i_elems) += val;
+               }
+            } // End of diagonal loop
          } // End of quadrature loop
       }); // End of Elements loop
+      // The diagonal now matches the tangent stiffness matrix used here
+      pa_diag_current = true;
    } // End of else statement
 }
 
@@ -606,6 +641,15 @@ void ExaNLFIntegrator::AssembleGradDiagonalPA(Vector &diag) const
 {
    CALI_CXX_MARK_SCOPE("enlfi_AssembleGradDiagonalPA");
 
+   // If AssembleGradPA has already been called for the current tangent stiffness matrix
+   // the diagonal was computed alongside the D tensor and we only need to add it to our output.
+   // It's only used the once, so any later calls recompute it unless AssembleGradPA is rerun.
+   if (pa_diag_current) {
+      pa_diag_current = false;
+      diag += pa_diag;
+      return;
+   }
+
    const IntegrationRule &ir = model->GetMatGrad()->GetSpace()->GetElementIntRule(0);
    auto W = ir.GetWeights().Read();
 
@@ -1571,6 +1615,15 @@ void ICExaNLFIntegrator::AssembleEA(const mfem::FiniteElementSpace &fes, mfem::V
 void ICExaNLFIntegrator::AssembleGradDiagonalPA(Vector &diag) const
 {
    CALI_CXX_MARK_SCOPE("icenlfi_AssembleGradDiagonalPA");
+
+   // If AssembleGradPA has already been called for the current tangent stiffness matrix
+   // the diagonal was computed alongside the D tensor and we only need to add it to our output.
+   // It's only used the once, so any later calls recompute it unless AssembleGradPA is rerun.
+   if (pa_diag_current) {
+      pa_diag_current = false;
+      diag += pa_diag;
+      return;
+   }
    const IntegrationRule &ir = model->GetMatGrad()->GetSpace()->GetElementIntRule(0);
    auto W = ir.GetWeights().Read();
 
@@ -1770,6 +1823,7 @@ void ICExaNLFIntegrator::AssembleGradDiagonalPA(Vector &diag) const
 void ICExaNLFIntegrator::AssemblePA(const FiniteElementSpace &fes)
 {
    CALI_CXX_MARK_SCOPE("icenlfi_assemblePA");
+   pa_diag_current = false;
    Mesh *mesh = fes.GetMesh();
    const FiniteElement &el = *fes.GetFE(0);
    space_dims = el.GetDim();
@@ -2039,4 +2093,313 @@ void ICExaNLFIntegrator::AddMultPA(const mfem::Vector & /*x*/, mfem::Vector &y)
          } // End of nQpts
       }); // End of nelems
    } // End of if statement
-}
\ No newline at end of file
+}
+// This performs the assembly step of our Bbar PA Jacobian. We only need to store
+// the material tangent stiffness matrix scaled by our quadrature weights, det(J), and dt.
+// The Bbar terms are formed within the action itself from our element averaged
+// shape function gradients (eDS) that were computed in AssemblePA.
+void ICExaNLFIntegrator::AssembleGradPA(const FiniteElementSpace &fes)
+{
+   CALI_CXX_MARK_SCOPE("icenlfi_assemblePAG");
+   pa_diag_current = false;
+   const FiniteElement &el = *fes.GetFE(0);
+   space_dims = el.GetDim();
+   const IntegrationRule *ir = &(IntRules.Get(el.GetGeomType(), 2 * el.GetOrder() + 1));
+
+   nqpts = ir->GetNPoints();
+   nnodes = el.GetDof();
+   nelems = fes.GetNE();
+   auto W = ir->GetWeights().Read();
+
+   if ((space_dims == 1) || (space_dims == 2)) {
+      MFEM_ABORT("Dimensions of 1 or 2 not supported.");
+   }
+   else {
+      const int dim = 3;
+
+      if (eDS.Size() != (nnodes * dim * nelems)) {
+         MFEM_ABORT("ICExaNLFIntegrator::AssemblePA needs to be called before AssembleGradPA");
+      }
+
+      if (pa_dmat.Size() != (2 * dim * 2 * dim * nqpts * nelems)) {
+         pa_dmat.SetSize(2 * dim * 2 * dim * nqpts * nelems, mfem::Device::GetMemoryType());
+         pa_dmat.UseDevice(true);
+      }
+
+      if (pa_diag.Size() != (nnodes * dim * nelems)) {
+         pa_diag.SetSize(nnodes * dim * nelems, mfem::Device::GetMemoryType());
+         pa_diag.UseDevice(true);
+      }
+
+      pa_diag = 0.0;
+
+      const int DIM2 = 2;
+      const int DIM3 = 3;
+      const int DIM4 = 4;
+      std::array<RAJA::idx_t, DIM4> perm4 {{ 3, 2, 1, 0 } };
+      std::array<RAJA::idx_t, DIM3> perm3 {{ 2, 1, 0 } };
+      std::array<RAJA::idx_t, DIM2> perm2 {{ 1, 0 } };
+
+      // bunch of helper RAJA views to make dealing with data easier down below in our kernel.
+      RAJA::Layout<DIM4> layout_tensor = RAJA::make_permuted_layout({{ 2 * dim, 2 * dim, nqpts, nelems } }, perm4);
+      RAJA::View<const double, RAJA::Layout<DIM4, RAJA::Index_type, 0> > K(model->GetMatGrad()->Read(), layout_tensor);
+      RAJA::View<double, RAJA::Layout<DIM4, RAJA::Index_type, 0> > D(pa_dmat.Write(), layout_tensor);
+
+      RAJA::Layout<DIM4> layout_jacob = RAJA::make_permuted_layout({{ dim, dim, nqpts, nelems } }, perm4);
+      RAJA::View<const double, RAJA::Layout<DIM4, RAJA::Index_type, 0> > J(jacobian.Read(), layout_jacob);
+
+      // The diagonal of our operator is formed at the same time as the D matrix, so
+      // AssembleGradDiagonalPA doesn't need to make another pass over our quadrature data.
+      RAJA::Layout<DIM3> layout_field = RAJA::make_permuted_layout({{ nnodes, dim, nelems } }, perm3);
+      RAJA::View<double, RAJA::Layout<DIM3, RAJA::Index_type, 0> > Ydiag(pa_diag.ReadWrite(), layout_field);
+
+      RAJA::Layout<DIM3> layout_grads = RAJA::make_permuted_layout({{ nnodes, dim, nqpts } }, perm3);
+      RAJA::View<const double, RAJA::Layout<DIM3, RAJA::Index_type, 0> > Gt(grad.Read(), layout_grads);
+
+      RAJA::Layout<DIM3> layout_egrads = RAJA::make_permuted_layout({{ nnodes, dim, nelems } }, perm3);
+      RAJA::View<const double, RAJA::Layout<DIM3, RAJA::Index_type, 0> > eDS_view(eDS.Read(), layout_egrads);
+
+      RAJA::Layout<DIM2> layout_adj = RAJA::make_permuted_layout({{ dim, dim } }, perm2);
+
+      const double dt = model->GetModelDt();
+      const double i3 = 1.0 / 3.0;
+      // This loop we'll want to parallelize the rest are all serial for now.
+      MFEM_FORALL(i_elems, nelems, {
+         double adj[dim * dim];
+         double idetJ;
+         // So, we're going to say this view is constant however we're going to mutate the values only in
+         // that one scoped section for the quadrature points.
+         RAJA::View<const double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > A(&adj[0], layout_adj);
+         for (int j_qpts = 0; j_qpts < nqpts; j_qpts++) {
+            {
+               const double J11 = J(0, 0, j_qpts, i_elems); // 0,0
+               const double J21 = J(1, 0, j_qpts, i_elems); // 1,0
+               const double J31 = J(2, 0, j_qpts, i_elems); // 2,0
+               const double J12 = J(0, 1, j_qpts, i_elems); // 0,1
+               const double J22 = J(1, 1, j_qpts, i_elems); // 1,1
+               const double J32 = J(2, 1, j_qpts, i_elems); // 2,1
+               const double J13 = J(0, 2, j_qpts, i_elems); // 0,2
+               const double J23 = J(1, 2, j_qpts, i_elems); // 1,2
+               const double J33 = J(2, 2, j_qpts, i_elems); // 2,2
+               const double detJ = J11 * (J22 * J33 - J32 * J23) -
+                                   /* */ J21 * (J12 * J33 - J32 * J13) +
+                                   /* */ J31 * (J12 * J23 - J22 * J13);
+               idetJ = 1.0 / detJ;
+               const double c_detJ = detJ * W[j_qpts] * dt;
+               for (int j = 0; j < 2 * dim; j++) {
+                  for (int i = 0; i < 2 * dim; i++) {
+                     D(i, j, j_qpts, i_elems) = c_detJ * K(i, j, j_qpts, i_elems);
+                  }
+               }
+               // adj(J)
+               adj[0] = (J22 * J33) - (J23 * J32); // 0,0
+               adj[1] = (J32 * J13) - (J12 * J33); // 0,1
+               adj[2] = (J12 * J23) - (J22 * J13); // 0,2
+               adj[3] = (J31 * J23) - (J21 * J33); // 1,0
+               adj[4] = (J11 * J33) - (J13 * J31); // 1,1
+               adj[5] = (J21 * J13) - (J11 * J23); // 1,2
+               adj[6] = (J21 * J32) - (J31 * J22); // 2,0
+               adj[7] = (J31 * J12) - (J11 * J32); // 2,1
+               adj[8] = (J11 * J22) - (J12 * J21); // 2,2
+            }
+
+            // Diagonal terms of our operator while D is still hot in cache:
+            // diag_{kc} = Bbar_{kc}^T D Bbar_{kc}
+            for (int knds = 0; knds < nnodes; knds++) {
+               const double bx = idetJ * (Gt(knds, 0, j_qpts) * A(0, 0)
+                                        + Gt(knds, 1, j_qpts) * A(0, 1)
+                                        + Gt(knds, 2, j_qpts) * A(0, 2));
+
+               const double by = idetJ * (Gt(knds, 0, j_qpts) * A(1, 0)
+                                        + Gt(knds, 1, j_qpts) * A(1, 1)
+                                        + Gt(knds, 2, j_qpts) * A(1, 2));
+
+               const double bz = idetJ * (Gt(knds, 0, j_qpts) * A(2, 0)
+                                        + Gt(knds, 1, j_qpts) * A(2, 1)
+                                        + Gt(knds, 2, j_qpts) * A(2, 2));
+
+               const double b4 = i3 * (eDS_view(knds, 0, i_elems) - bx);
+               const double b5 = b4 + bx;
+               const double b6 = i3 * (eDS_view(knds, 1, i_elems) - by);
+               const double b7 = b6 + by;
+               const double b8 = i3 * (eDS_view(knds, 2, i_elems) - bz);
+               const double b9 = b8 + bz;
+
+               // Columns of our Bbar matrix associated with each dof of this node
+               const double B[3][6] = {{ b5, b4, b4, 0.0, bz, by },
+                  { b6, b7, b6, bz, 0.0, bx },
+                  { b8, b8, b9, by, bx, 0.0 } };
+
+               for (int c = 0; c < dim; c++) {
+                  double val = 0.0;
+                  for (int j = 0; j < 2 * dim; j++) {
+                     double tmp = 0.0;
+                     for (int i = 0; i < 2 * dim; i++) {
+                        tmp += B[c][i] * D(i, j, j_qpts, i_elems);
+                     }
+                     val += tmp * B[c][j];
+                  }
+                  Ydiag(knds, c, i_elems) += val;
+               }
+            } // End of nnodes
+         } // End of quadrature loop
+      }); // End of Elements loop
+      // The diagonal now matches the tangent stiffness matrix used here
+      pa_diag_current = true;
+   } // End of else statement
+}
+
+// Here we're applying the following action operation using the assembled "D" 2nd order
+// tensor found above:
+// y = Bbar^T D Bbar x
+// where our Bbar matrix for a given node takes the form of
+//           | b5 b6 b8 |
+//           | b4 b7 b8 |
+// Bbar_a =  | b4 b6 b9 |
+//           | 0  bz by |
+//           | bz 0  bx |
+//           | by bx 0  |
+// with b4 = 1/3 (eDS_x - bx), b5 = b4 + bx and likewise for the other directions.
+// This is the same B matrix that's used within our residual and EA calculations.
+void ICExaNLFIntegrator::AddMultGradPA(const mfem::Vector &x, mfem::Vector &y) const
+{
+   CALI_CXX_MARK_SCOPE("icenlfi_amPAG");
+   if ((space_dims == 1) || (space_dims == 2)) {
+      MFEM_ABORT("Dimensions of 1 or 2 not supported.");
+   }
+   else {
+      const int dim = 3;
+      const int DIM2 = 2;
+      const int DIM3 = 3;
+      const int DIM4 = 4;
+
+      std::array<RAJA::idx_t, DIM4> perm4 {{ 3, 2, 1, 0 } };
+      std::array<RAJA::idx_t, DIM3> perm3 {{ 2, 1, 0 } };
+      std::array<RAJA::idx_t, DIM2> perm2 {{ 1, 0 } };
+
+      RAJA::Layout<DIM4> layout_tensor = RAJA::make_permuted_layout({{ 2 * dim, 2 * dim, nqpts, nelems } }, perm4);
+      RAJA::View<const double, RAJA::Layout<DIM4, RAJA::Index_type, 0> > D(pa_dmat.Read(), layout_tensor);
+
+      RAJA::Layout<DIM4> layout_jacob = RAJA::make_permuted_layout({{ dim, dim, nqpts, nelems } }, perm4);
+      RAJA::View<const double, RAJA::Layout<DIM4, RAJA::Index_type, 0> > J(jacobian.Read(), layout_jacob);
+
+      // Our field variables that are inputs and outputs
+      RAJA::Layout<DIM3> layout_field = RAJA::make_permuted_layout({{ nnodes, dim, nelems } }, perm3);
+      RAJA::View<const double, RAJA::Layout<DIM3, RAJA::Index_type, 0> > X(x.Read(), layout_field);
+      RAJA::View<double, RAJA::Layout<DIM3, RAJA::Index_type, 0> > Y(y.ReadWrite(), layout_field);
+      // Transpose of the local gradient variable
+      RAJA::Layout<DIM3> layout_grads = RAJA::make_permuted_layout({{ nnodes, dim, nqpts } }, perm3);
+      RAJA::View<const double, RAJA::Layout<DIM3, RAJA::Index_type, 0> > Gt(grad.Read(), layout_grads);
+
+      RAJA::Layout<DIM3> layout_egrads = RAJA::make_permuted_layout({{ nnodes, dim, nelems } }, perm3);
+      RAJA::View<const double, RAJA::Layout<DIM3, RAJA::Index_type, 0> > eDS_view(eDS.Read(), layout_egrads);
+
+      RAJA::Layout<DIM2> layout_adj = RAJA::make_permuted_layout({{ dim, dim } }, perm2);
+
+      const double i3 = 1.0 / 3.0;
+      // This loop we'll want to parallelize the rest are all serial for now.
+      MFEM_FORALL(i_elems, nelems, {
+         double adj[dim * dim];
+         double idetJ;
+         // So, we're going to say this view is constant however we're going to mutate the values only in
+         // that one scoped section for the quadrature points.
+         RAJA::View<const double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > A(&adj[0], layout_adj);
+         for (int j_qpts = 0; j_qpts < nqpts; j_qpts++) {
+            // If we scope this then we only need to carry half the number of variables around with us for
+            // the adjugate term.
+            {
+               const double J11 = J(0, 0, j_qpts, i_elems); // 0,0
+               const double J21 = J(1, 0, j_qpts, i_elems); // 1,0
+               const double J31 = J(2, 0, j_qpts, i_elems); // 2,0
+               const double J12 = J(0, 1, j_qpts, i_elems); // 0,1
+               const double J22 = J(1, 1, j_qpts, i_elems); // 1,1
+               const double J32 = J(2, 1, j_qpts, i_elems); // 2,1
+               const double J13 = J(0, 2, j_qpts, i_elems); // 0,2
+               const double J23 = J(1, 2, j_qpts, i_elems); // 1,2
+               const double J33 = J(2, 2, j_qpts, i_elems); // 2,2
+               const double detJ = J11 * (J22 * J33 - J32 * J23) -
+                                   /* */ J21 * (J12 * J33 - J32 * J13) +
+                                   /* */ J31 * (J12 * J23 - J22 * J13);
+               idetJ = 1.0 / detJ;
+               // adj(J)
+               adj[0] = (J22 * J33) - (J23 * J32); // 0,0
+               adj[1] = (J32 * J13) - (J12 * J33); // 0,1
+               adj[2] = (J12 * J23) - (J22 * J13); // 0,2
+               adj[3] = (J31 * J23) - (J21 * J33); // 1,0
+               adj[4] = (J11 * J33) - (J13 * J31); // 1,1
+               adj[5] = (J21 * J13) - (J11 * J23); // 1,2
+               adj[6] = (J21 * J32) - (J31 * J22); // 2,0
+               adj[7] = (J31 * J12) - (J11 * J32); // 2,1
+               adj[8] = (J11 * J22) - (J12 * J21); // 2,2
+            }
+
+            // Strain like term E = Bbar x where the volumetric part is shared by all
+            // of the normal components.
+            double vol = 0.0;
+            double E[6] = { 0, 0, 0, 0, 0, 0 };
+            for (int knds = 0; knds < nnodes; knds++) {
+               const double bx = idetJ * (Gt(knds, 0, j_qpts) * A(0, 0)
+                                        + Gt(knds, 1, j_qpts) * A(0, 1)
+                                        + Gt(knds, 2, j_qpts) * A(0, 2));
+
+               const double by = idetJ * (Gt(knds, 0, j_qpts) * A(1, 0)
+                                        + Gt(knds, 1, j_qpts) * A(1, 1)
+                                        + Gt(knds, 2, j_qpts) * A(1, 2));
+
+               const double bz = idetJ * (Gt(knds, 0, j_qpts) * A(2, 0)
+                                        + Gt(knds, 1, j_qpts) * A(2, 1)
+                                        + Gt(knds, 2, j_qpts) * A(2, 2));
+
+               const double xx = X(knds, 0, i_elems);
+               const double xy = X(knds, 1, i_elems);
+               const double xz = X(knds, 2, i_elems);
+
+               vol += i3 * ((eDS_view(knds, 0, i_elems) - bx) * xx
+                          + (eDS_view(knds, 1, i_elems) - by) * xy
+                          + (eDS_view(knds, 2, i_elems) - bz) * xz);
+               E[0] += bx * xx;
+               E[1] += by * xy;
+               E[2] += bz * xz;
+               E[3] += bz * xy + by * xz;
+               E[4] += bz * xx + bx * xz;
+               E[5] += by * xx + bx * xy;
+            }
+            E[0] += vol;
+            E[1] += vol;
+            E[2] += vol;
+
+            // T = D E
+            double T[6] = { 0, 0, 0, 0, 0, 0 };
+            for (int j = 0; j < 2 * dim; j++) {
+               for (int i = 0; i < 2 * dim; i++) {
+                  T[i] += D(i, j, j_qpts, i_elems) * E[j];
+               }
+            }
+
+            const double tvol = T[0] + T[1] + T[2];
+            // Final action of Y += Bbar^T T
+            for (int knds = 0; knds < nnodes; knds++) {
+               const double bx = idetJ * (Gt(knds, 0, j_qpts) * A(0, 0)
+                                        + Gt(knds, 1, j_qpts) * A(0, 1)
+                                        + Gt(knds, 2, j_qpts) * A(0, 2));
+
+               const double by = idetJ * (Gt(knds, 0, j_qpts) * A(1, 0)
+                                        + Gt(knds, 1, j_qpts) * A(1, 1)
+                                        + Gt(knds, 2, j_qpts) * A(1, 2));
+
+               const double bz = idetJ * (Gt(knds, 0, j_qpts) * A(2, 0)
+                                        + Gt(knds, 1, j_qpts) * A(2, 1)
+                                        + Gt(knds, 2, j_qpts) * A(2, 2));
+
+               const double b4 = i3 * (eDS_view(knds, 0, i_elems) - bx);
+               const double b6 = i3 * (eDS_view(knds, 1, i_elems) - by);
+               const double b8 = i3 * (eDS_view(knds, 2, i_elems) - bz);
+
+               Y(knds, 0, i_elems) += b4 * tvol + bx * T[0] + bz * T[4] + by * T[5];
+               Y(knds, 1, i_elems) += b6 * tvol + by * T[1] + bz * T[3] + bx * T[5];
+               Y(knds, 2, i_elems) += b8 * tvol + bz * T[2] + by * T[3] + bx * T[4];
+            } // End of nnodes
+         } // End of nQpts
+      }); // End of nelems
+   } // End of if statement
+}
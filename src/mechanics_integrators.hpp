@@ -20,12 +20,17 @@ class ExaNLFIntegrator : public mfem::NonlinearFormIntegrator
       mfem::Vector grad;
       mfem::Vector *tan_mat; // Not owned
       mfem::Vector pa_dmat;
+      // Diagonal of our PA operator which is formed within AssembleGradPA.
+      // pa_diag_current is set by AssembleGradPA, and it's cleared once the diagonal is used
+      // or the stress / tangent stiffness terms are reassembled.
+      mfem::Vector pa_diag;
+      mutable bool pa_diag_current;
       mfem::Vector jacobian;
       const mfem::GeometricFactors *geom; // Not owned
       int space_dims, nelems, nqpts, nnodes;
 
    public:
-      ExaNLFIntegrator(ExaModel *m) : model(m) { }
+      ExaNLFIntegrator(ExaModel *m) : model(m), pa_diag_current(false) { }
 
       virtual ~ExaNLFIntegrator() { }
 
@@ -102,10 +107,17 @@ class ICExaNLFIntegrator : public ExaNLFIntegrator
                                        mfem::ElementTransformation &Ttr,
                                        const mfem::Vector & /*elfun*/, mfem::DenseMatrix &elmat) override;
 
-      // This method doesn't easily extend to PA formulation, so we're punting on
-      // it for now.
-      using ExaNLFIntegrator::AssembleGradPA;
-      using ExaNLFIntegrator::AddMultGradPA;
+      /** @brief Performs the initial assembly operation of our Bbar PA Jacobian.
+      *
+      *   Unlike the full integration version we don't form the 4D tensor here.
+      *   Instead the 6x6 material tangent stiffness matrix at each quadrature point
+      *   is scaled by det(J) * w_{qpt} * dt and stored. The Bbar terms are formed on
+      *   the fly in AddMultGradPA from the element averaged shape function gradients,
+      *   so AssemblePA must be called before this function.
+      */
+      virtual void AssembleGradPA(const mfem::FiniteElementSpace &fes) override;
+      /// Applies the action y += Bbar^T D Bbar x using the data from AssembleGradPA
+      virtual void AddMultGradPA(const mfem::Vector &x, mfem::Vector &y) const override;
 
       using mfem::NonlinearFormIntegrator::AssemblePA;
       // We've got to override this as well for the Bbar method...
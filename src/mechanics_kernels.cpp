@@ -1,22 +1,29 @@
 #include "mechanics_kernels.hpp"
 #include "mfem/general/forall.hpp"
+#include <set>
+#include <array>
+#include <algorithm>
+#include <cstdlib>
 
 namespace exaconstit{
 namespace kernel {
 
-void grad_calc(const int nqpts, const int nelems, const int nnodes,
-                const double *jacobian_data, const double *loc_grad_data,
-                const double *field_data, double* field_grad_array)
+namespace {
+// The field gradient kernel itself. If T_NNODES is non-zero then the number of nodes is known
+// at compile time which allows the compiler to fully unroll / vectorize the inner node loops.
+// This is done for the linear, quadratic, and cubic hex elements.
+template<int T_NNODES = 0>
+void grad_calc_kernel(const int nqpts, const int nelems, const int nnodes,
+                      const double *jacobian_data, const double *loc_grad_data,
+                      const double *field_data, double* field_grad_array)
 {
     const int DIM4 = 4;
     const int DIM3 = 3;
-    const int DIM2 = 2;
     std::array<RAJA::idx_t, DIM4> perm4 {{ 3, 2, 1, 0 } };
     std::array<RAJA::idx_t, DIM3> perm3{{ 2, 1, 0 } };
-    std::array<RAJA::idx_t, DIM2> perm2{{ 1, 0 } };
 
     const int dim = 3;
-    const int space_dim2 = dim * dim;
+    const int nnodes_ = T_NNODES ? T_NNODES : nnodes;
 
     // bunch of helper RAJA views to make dealing with data easier down below in our kernel.
     RAJA::Layout<DIM4> layout_jacob = RAJA::make_permuted_layout({{ dim, dim, nqpts, nelems } }, perm4);
@@ -25,16 +32,28 @@ void grad_calc(const int nqpts, const int nelems, const int nnodes,
     RAJA::Layout<DIM4> layout_grad = RAJA::make_permuted_layout({{ dim, dim, nqpts, nelems } }, perm4);
     RAJA::View<double, RAJA::Layout<DIM4, RAJA::Index_type, 0> > field_grad_view(field_grad_array, layout_grad);
     // velocity
-    RAJA::Layout<DIM3> layout_field = RAJA::make_permuted_layout({{ nnodes, dim, nelems } }, perm3);
+    RAJA::Layout<DIM3> layout_field = RAJA::make_permuted_layout({{ nnodes_, dim, nelems } }, perm3);
     RAJA::View<const double, RAJA::Layout<DIM3, RAJA::Index_type, 0> > field_view(field_data, layout_field);
     // loc_grad
-    RAJA::Layout<DIM3> layout_loc_grad = RAJA::make_permuted_layout({{ nnodes, dim, nqpts } }, perm3);
+    RAJA::Layout<DIM3> layout_loc_grad = RAJA::make_permuted_layout({{ nnodes_, dim, nqpts } }, perm3);
     RAJA::View<const double, RAJA::Layout<DIM3, RAJA::Index_type, 0> > loc_grad_view(loc_grad_data, layout_loc_grad);
 
-    RAJA::Layout<DIM2> layout_jinv = RAJA::make_permuted_layout({{ dim, dim } }, perm2);
-
     mfem::MFEM_FORALL(i_elems, nelems, {
+        const int NNODES = T_NNODES ? T_NNODES : nnodes_;
         for (int j_qpts = 0; j_qpts < nqpts; j_qpts++) {
+            // We first contract our field with the local shape function gradients which
+            // gives us the field gradient with respect to the reference element:
+            // G_{qs} = field_{rq} loc_grad_{rs}
+            double G[dim][dim] = {{ 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }, { 0.0, 0.0, 0.0 }};
+            for (int q = 0; q < dim; q++) {
+                for (int r = 0; r < NNODES; r++) {
+                    const double fval = field_view(r, q, i_elems);
+                    G[q][0] += fval * loc_grad_view(r, 0, j_qpts);
+                    G[q][1] += fval * loc_grad_view(r, 1, j_qpts);
+                    G[q][2] += fval * loc_grad_view(r, 2, j_qpts);
+                }
+            }
+
             const double J11 = J(0, 0, j_qpts, i_elems); // 0,0
             const double J21 = J(1, 0, j_qpts, i_elems); // 1,0
             const double J31 = J(2, 0, j_qpts, i_elems); // 2,0
@@ -48,7 +67,7 @@ void grad_calc(const int nqpts, const int nelems, const int nnodes,
                                 /* */ J21 * (J12 * J33 - J32 * J13) +
                                 /* */ J31 * (J12 * J23 - J22 * J13);
             const double c_detJ = 1.0 / detJ;
-            // adj(J)
+            // J^{-1} = adj(J) / det(J)
             const double A11 = c_detJ * ((J22 * J33) - (J23 * J32));
             const double A12 = c_detJ * ((J32 * J13) - (J12 * J33));
             const double A13 = c_detJ * ((J12 * J23) - (J22 * J13));
@@ -58,24 +77,227 @@ void grad_calc(const int nqpts, const int nelems, const int nnodes,
             const double A31 = c_detJ * ((J21 * J32) - (J31 * J22));
             const double A32 = c_detJ * ((J31 * J12) - (J11 * J32));
             const double A33 = c_detJ * ((J11 * J22) - (J12 * J21));
-            const double A[space_dim2] = { A11, A21, A31, A12, A22, A32, A13, A23, A33 };
-            // Raja view to make things easier again
-
-            RAJA::View<const double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > jinv_view(&A[0], layout_jinv);
-            // All of the data down below is ordered in column major order
-            for (int t = 0; t < dim; t++) {
-            for (int s = 0; s < dim; s++) {
-                for (int r = 0; r < nnodes; r++) {
-                    for (int q = 0; q < dim; q++) {
-                        field_grad_view(q, t, j_qpts, i_elems) += field_view(r, q, i_elems) *
-                                                                loc_grad_view(r, s, j_qpts) * jinv_view(s, t);
-                    }
-                }
-            }
+
+            // Now we can apply J^{-1} to get the gradient in the current configuration
+            // field_grad_{qt} = G_{qs} J^{-1}_{st}
+            // We write our values out rather than accumulate them, so the output array
+            // doesn't need to be zeroed out beforehand.
+            for (int q = 0; q < dim; q++) {
+                field_grad_view(q, 0, j_qpts, i_elems) = G[q][0] * A11 + G[q][1] * A21 + G[q][2] * A31;
+                field_grad_view(q, 1, j_qpts, i_elems) = G[q][0] * A12 + G[q][1] * A22 + G[q][2] * A32;
+                field_grad_view(q, 2, j_qpts, i_elems) = G[q][0] * A13 + G[q][1] * A23 + G[q][2] * A33;
             } // End of loop used to calculate field gradient
         } // end of forall loop for quadrature points
     }); // end of forall loop for number of elements
+}
+}
+
+void grad_calc(const int nqpts, const int nelems, const int nnodes,
+                const double *jacobian_data, const double *loc_grad_data,
+                const double *field_data, double* field_grad_array)
+{
+    // Specialized versions for the 1st - 3rd order hex elements
+    switch (nnodes) {
+        case 8:
+            grad_calc_kernel<8>(nqpts, nelems, nnodes, jacobian_data, loc_grad_data, field_data, field_grad_array);
+            break;
+        case 27:
+            grad_calc_kernel<27>(nqpts, nelems, nnodes, jacobian_data, loc_grad_data, field_data, field_grad_array);
+            break;
+        case 64:
+            grad_calc_kernel<64>(nqpts, nelems, nnodes, jacobian_data, loc_grad_data, field_data, field_grad_array);
+            break;
+        default:
+            grad_calc_kernel(nqpts, nelems, nnodes, jacobian_data, loc_grad_data, field_data, field_grad_array);
+            break;
+    }
 } // end of kernel_grad_calc
 
+void jacobian_setup(const int nqpts, const int nelems, const int space_dims,
+                    const double *geom_j_data, double* jacobian_data)
+{
+    const int DIM4 = 4;
+    std::array<RAJA::idx_t, DIM4> perm4 {{ 3, 2, 1, 0 } };
+    // bunch of helper RAJA views to make dealing with data easier down below in our kernel.
+    RAJA::Layout<DIM4> layout_jacob = RAJA::make_permuted_layout({{ space_dims, space_dims, nqpts, nelems } }, perm4);
+    RAJA::View<double, RAJA::Layout<DIM4, RAJA::Index_type, 0> > jac_view(jacobian_data, layout_jacob);
+
+    RAJA::Layout<DIM4> layout_geom = RAJA::make_permuted_layout({{ nqpts, space_dims, space_dims, nelems } }, perm4);
+    RAJA::View<const double, RAJA::Layout<DIM4, RAJA::Index_type, 0> > geom_j_view(geom_j_data, layout_geom);
+
+    mfem::MFEM_FORALL(i, nelems, {
+        for (int j = 0; j < nqpts; j++) {
+            for (int k = 0; k < space_dims; k++) {
+                for (int l = 0; l < space_dims; l++) {
+                    jac_view(l, k, j, i) = geom_j_view(j, l, k, i);
+                }
+            }
+        }
+    });
+} // end of jacobian_setup
+
+// Generates the unique plane normals of a cubic {hkl} family in the crystal frame.
+// A normal and its negative are treated as the same plane.
+void CubicFamilyNormals(const std::vector<int> &hkl, std::vector<double> &normals)
+{
+    std::set<std::array<int, 3> > family;
+    std::array<int, 3> perm = {{ std::abs(hkl[0]), std::abs(hkl[1]), std::abs(hkl[2]) }};
+    std::sort(perm.begin(), perm.end());
+    do {
+        for (int signs = 0; signs < 8; signs++) {
+            std::array<int, 3> n;
+            for (int i = 0; i < 3; i++) {
+                n[i] = (signs & (1 << i)) ? -perm[i] : perm[i];
+            }
+            // Only keep the normal whose first non-zero component is positive
+            int first = 0;
+            while (first < 3 && n[first] == 0) { first++; }
+            if (first < 3 && n[first] > 0) {
+                family.insert(n);
+            }
+        }
+    } while (std::next_permutation(perm.begin(), perm.end()));
+
+    for (auto &n : family) {
+        const double inv_norm = 1.0 / sqrt((double) (n[0] * n[0] + n[1] * n[1] + n[2] * n[2]));
+        for (int i = 0; i < 3; i++) {
+            normals.push_back(n[i] * inv_norm);
+        }
+    }
+}
+
+// The proper rotations of the cubic and hexagonal crystal symmetry groups as quaternions.
+// The hexagonal c-axis is taken to be along the crystal z-axis.
+void CrystalSymmetries(const XtalType xtal_type, std::vector<double> &syms)
+{
+    const double isqrt2 = 1.0 / sqrt(2.0);
+    if (xtal_type == XtalType::HCP) {
+        for (int k = 0; k < 6; k++) {
+            const double ang = k * M_PI / 6.0;
+            // 60 degree rotations about the c-axis
+            syms.insert(syms.end(), { cos(ang), 0.0, 0.0, sin(ang) });
+            // 180 degree rotations about the in-plane axes
+            syms.insert(syms.end(), { 0.0, cos(ang), sin(ang), 0.0 });
+        }
+    }
+    else {
+        syms.insert(syms.end(), { 1.0, 0.0, 0.0, 0.0 });
+        // 90, 180, and 270 degree rotations about the <100> axes
+        for (int i = 0; i < 3; i++) {
+            double q90[4] = { isqrt2, 0.0, 0.0, 0.0 };
+            double q180[4] = { 0.0, 0.0, 0.0, 0.0 };
+            double q270[4] = { isqrt2, 0.0, 0.0, 0.0 };
+            q90[i + 1] = isqrt2;
+            q180[i + 1] = 1.0;
+            q270[i + 1] = -isqrt2;
+            syms.insert(syms.end(), q90, q90 + 4);
+            syms.insert(syms.end(), q180, q180 + 4);
+            syms.insert(syms.end(), q270, q270 + 4);
+        }
+        // 120 and 240 degree rotations about the <111> axes
+        for (int signs = 0; signs < 8; signs++) {
+            syms.insert(syms.end(), { 0.5,
+                                      (signs & 1) ? -0.5 : 0.5,
+                                      (signs & 2) ? -0.5 : 0.5,
+                                      (signs & 4) ? -0.5 : 0.5 });
+        }
+        // 180 degree rotations about the <110> axes
+        syms.insert(syms.end(), { 0.0, isqrt2, isqrt2, 0.0 });
+        syms.insert(syms.end(), { 0.0, isqrt2, -isqrt2, 0.0 });
+        syms.insert(syms.end(), { 0.0, isqrt2, 0.0, isqrt2 });
+        syms.insert(syms.end(), { 0.0, isqrt2, 0.0, -isqrt2 });
+        syms.insert(syms.end(), { 0.0, 0.0, isqrt2, isqrt2 });
+        syms.insert(syms.end(), { 0.0, 0.0, isqrt2, -isqrt2 });
+    }
+}
+
+void ComputeVolSums(const mfem::ParFiniteElementSpace* fes,
+                    const std::vector<const mfem::QuadratureFunction*> &qfs,
+                    const std::vector<std::pair<int, int> > &comps,
+                    const std::vector<bool> &soa,
+                    mfem::Vector &elem_sums,
+                    double* data)
+{
+    mfem::Mesh *mesh = fes->GetMesh();
+    const mfem::FiniteElement &el = *fes->GetFE(0);
+    const mfem::IntegrationRule *ir = &(mfem::IntRules.Get(el.GetGeomType(), 2 * el.GetOrder() + 1));
+
+    const int nqpts = ir->GetNPoints();
+    const int nelems = fes->GetNE();
+    const int npts = nqpts * nelems;
+
+    const double* W = ir->GetWeights().Read();
+    const mfem::GeometricFactors *geom = mesh->GetGeometricFactors(*ir, mfem::GeometricFactors::DETERMINANTS);
+
+    int ncomps = 1;
+    for (auto &comp : comps) {
+        ncomps += comp.second;
+    }
+
+    elem_sums.SetSize(ncomps * nelems, mfem::Device::GetMemoryType());
+    elem_sums.UseDevice(true);
+
+    const int DIM2 = 2;
+    std::array<RAJA::idx_t, DIM2> perm2 {{ 1, 0 } };
+    RAJA::Layout<DIM2> layout_geom = RAJA::make_permuted_layout({{ nqpts, nelems } }, perm2);
+    RAJA::Layout<DIM2> layout_sums = RAJA::make_permuted_layout({{ ncomps, nelems } }, perm2);
+    RAJA::View<const double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > j_view(geom->detJ.Read(), layout_geom);
+    RAJA::View<double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > sums_view(elem_sums.Write(), layout_sums);
+
+    // The element volumes are the first component
+    mfem::MFEM_FORALL(i, nelems, {
+        const int nqpts_ = nqpts;
+        double vol = 0.0;
+        for (int j = 0; j < nqpts_; j++) {
+            vol += j_view(j, i) * W[j];
+        }
+        sums_view(0, i) = vol;
+    });
+
+    // Each quadrature function is only read through once with all of its components
+    // being accumulated at the same time.
+    int offset = 1;
+    for (size_t k = 0; k < qfs.size(); k++) {
+        const int vdim = qfs[k]->GetVDim();
+        const int qf_off = comps[k].first;
+        const int qf_ncomps = comps[k].second;
+        const int off = offset;
+        // Strides between quadrature points and between components of the quadrature function
+        // which depend on whether the data is stored in a structure of arrays format or not
+        const int pt_stride = soa[k] ? 1 : vdim;
+        const int comp_stride = soa[k] ? npts : 1;
+        const double* qf_data = qfs[k]->Read();
+
+        mfem::MFEM_FORALL(i, nelems, {
+            const int nqpts_ = nqpts;
+            const int ncomps_ = qf_ncomps;
+            for (int m = 0; m < ncomps_; m++) {
+                sums_view(off + m, i) = 0.0;
+            }
+            for (int j = 0; j < nqpts_; j++) {
+                const double wts = j_view(j, i) * W[j];
+                const int ipt = i * nqpts_ + j;
+                for (int m = 0; m < ncomps_; m++) {
+                    sums_view(off + m, i) += wts * qf_data[ipt * pt_stride + (qf_off + m) * comp_stride];
+                }
+            }
+        });
+        offset += qf_ncomps;
+    }
+
+    // Now the element sums are reduced down to the rank's sums. The number of components is
+    // small, so rather than a device reduction per component the element sums are copied over
+    // to the host once and summed there. This also keeps the summation order the same run to run.
+    const double* sums_data = elem_sums.HostRead();
+    for (int m = 0; m < ncomps; m++) {
+        data[m] = 0.0;
+    }
+    for (int i = 0; i < nelems; i++) {
+        for (int m = 0; m < ncomps; m++) {
+            data[m] += sums_data[i * ncomps + m];
+        }
+    }
+}
+
 }
 }
\ No newline at end of file
@@ -5,126 +5,63 @@
 #include "RAJA/RAJA.hpp"
 #include "option_types.hpp"
 #include "mfem/general/forall.hpp"
+#include <vector>
+#include <utility>
 
 namespace exaconstit {
 namespace kernel {
 /// Performs all the calculations related to calculating the gradient of a 3D vector field
-/// grad_array should be set to 0.0 outside of this function.
+/// The values in grad_array are overwritten, so it doesn't need to be set to 0.0 beforehand.
+/// Specialized versions of the kernel are used for 1st - 3rd order hex elements.
 //  It is assumed that whatever data pointers being passed in is consistent with
 //  with the execution strategy being used by the MFEM_FORALL.
 void grad_calc(const int nqpts, const int nelems, const int nnodes,
                 const double *jacobian_data, const double *loc_grad_data,
                 const double *field_data, double* field_grad_array);
-//Computes the volume average values of values that lie at the quadrature points
-template<bool vol_avg>
-void ComputeVolAvgTensor(const mfem::ParFiniteElementSpace* fes,
-                        const mfem::QuadratureFunction* qf,
-                        mfem::Vector& tensor, int size,
-                        RTModel &class_device)
+/// Reorders the Jacobians of mfem's GeometricFactors (geom->J) from their (qpt, dim, dim, elem)
+/// ordering into the (dim, dim, qpt, elem) ordering that grad_calc and our integrators expect.
+//  It is assumed that whatever data pointers being passed in is consistent with
+//  with the execution strategy being used by the MFEM_FORALL.
+void jacobian_setup(const int nqpts, const int nelems, const int space_dims,
+                    const double *geom_j_data, double* jacobian_data);
+/// Generates the unique plane normals of a cubic {hkl} family in the crystal frame,
+/// and appends them to normals as unit vectors (3 values per normal).
+/// A normal and its negative are treated as the same plane.
+void CubicFamilyNormals(const std::vector<int> &hkl, std::vector<double> &normals);
+/// Appends the proper rotations of the cubic (24) or hexagonal (12) crystal symmetry group
+/// to syms as quaternions (4 values per rotation). Anything but XtalType::HCP is taken to be cubic.
+/// The hexagonal c-axis is taken to be along the crystal z-axis.
+void CrystalSymmetries(const XtalType xtal_type, std::vector<double> &syms);
+/// Converts a deviatoric symmetric tensor stored in ExaCMech's 5 component vecd format
+/// into a full 3x3 tensor and adds vol (the volumetric part) to its diagonal.
+MFEM_HOST_DEVICE inline
+void VecdToTensor(const double* vecd, const double vol, double* tensor)
 {
-    mfem::Mesh *mesh = fes->GetMesh();
-    const mfem::FiniteElement &el = *fes->GetFE(0);
-    const mfem::IntegrationRule *ir = &(mfem::IntRules.Get(el.GetGeomType(), 2 * el.GetOrder() + 1));;
-
-    const int nqpts = ir->GetNPoints();
-    const int nelems = fes->GetNE();
-    const int npts = nqpts * nelems;
-
-    const double* W = ir->GetWeights().Read();
-    const mfem::GeometricFactors *geom = mesh->GetGeometricFactors(*ir, mfem::GeometricFactors::DETERMINANTS);
-
-    double el_vol = 0.0;
-    int my_id;
-    MPI_Comm_rank(MPI_COMM_WORLD, &my_id);
-    double data[size];
-
-    const int DIM2 = 2;
-    std::array<RAJA::idx_t, DIM2> perm2 {{ 1, 0 } };
-    RAJA::Layout<DIM2> layout_geom = RAJA::make_permuted_layout({{ nqpts, nelems } }, perm2);
-
-    mfem::Vector wts(geom->detJ);
-    RAJA::View<double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > wts_view(wts.ReadWrite(), layout_geom);
-    RAJA::View<const double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > j_view(geom->detJ.Read(), layout_geom);
-
-    RAJA::RangeSegment default_range(0, npts);
-
-    mfem::MFEM_FORALL(i, nelems, {
-        const int nqpts_ = nqpts;
-        for (int j = 0; j < nqpts_; j++) {
-            wts_view(j, i) = j_view(j, i) * W[j];
-        }
-    });
-
-    if (class_device == RTModel::CPU) {
-        const double* qf_data = qf->HostRead();
-        const double* wts_data = wts.HostRead();
-        for (int j = 0; j < size; j++) {
-            RAJA::ReduceSum<RAJA::seq_reduce, double> seq_sum(0.0);
-            RAJA::ReduceSum<RAJA::seq_reduce, double> vol_sum(0.0);
-            RAJA::forall<RAJA::loop_exec>(default_range, [ = ] (int i_npts){
-                const double* val = &(qf_data[i_npts * size]);
-                seq_sum += wts_data[i_npts] * val[j];
-                vol_sum += wts_data[i_npts];
-            });
-            data[j] = seq_sum.get();
-            el_vol = vol_sum.get();
-        }
-    }
-    #if defined(RAJA_ENABLE_OPENMP)
-    if (class_device == RTModel::OPENMP) {
-        const double* qf_data = qf->HostRead();
-        const double* wts_data = wts.HostRead();
-        for (int j = 0; j < size; j++) {
-            RAJA::ReduceSum<RAJA::omp_reduce_ordered, double> omp_sum(0.0);
-            RAJA::ReduceSum<RAJA::omp_reduce_ordered, double> vol_sum(0.0);
-            RAJA::forall<RAJA::omp_parallel_for_exec>(default_range, [ = ] (int i_npts){
-                const double* val = &(qf_data[i_npts * size]);
-                omp_sum += wts_data[i_npts] * val[j];
-                vol_sum += wts_data[i_npts];
-            });
-            data[j] = omp_sum.get();
-            el_vol = vol_sum.get();
-        }
-    }
-    #endif
-    #if defined(RAJA_ENABLE_CUDA)
-    if (class_device == RTModel::CUDA) {
-        const double* qf_data = qf->Read();
-        const double* wts_data = wts.Read();
-        for (int j = 0; j < size; j++) {
-            RAJA::ReduceSum<RAJA::cuda_reduce, double> cuda_sum(0.0);
-            RAJA::ReduceSum<RAJA::cuda_reduce, double> vol_sum(0.0);
-            RAJA::forall<RAJA::cuda_exec<1024> >(default_range, [ = ] RAJA_DEVICE(int i_npts){
-                const double* val = &(qf_data[i_npts * size]);
-                cuda_sum += wts_data[i_npts] * val[j];
-                vol_sum += wts_data[i_npts];
-            });
-            data[j] = cuda_sum.get();
-            el_vol = vol_sum.get();
-        }
-    }
-    #endif
-
-    for (int i = 0; i < size; i++) {
-        tensor[i] = data[i];
-    }
-
-    MPI_Allreduce(&data, tensor.HostReadWrite(), size, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-    if (vol_avg) {
-        double temp = el_vol;
-
-        // Here we find what el_vol should be equal to
-        MPI_Allreduce(&temp, &el_vol, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
-
-        // We meed to multiple by 1/V by our tensor values to get the appropriate
-        // average value for the tensor in the end.
-        double inv_vol = 1.0 / el_vol;
-
-        for (int m = 0; m < size; m++) {
-            tensor[m] *= inv_vol;
-        }
-    }
+    const double isqrt2 = 1.0 / sqrt(2.0);
+    const double isqrt6 = 1.0 / sqrt(6.0);
+    tensor[0] = vecd[0] * isqrt2 - vecd[1] * isqrt6 + vol;
+    tensor[4] = -vecd[0] * isqrt2 - vecd[1] * isqrt6 + vol;
+    tensor[8] = sqrt(2.0 / 3.0) * vecd[1] + vol;
+    tensor[1] = tensor[3] = vecd[2] * isqrt2;
+    tensor[2] = tensor[6] = vecd[3] * isqrt2;
+    tensor[5] = tensor[7] = vecd[4] * isqrt2;
 }
+/// Computes the rank's volume weighted sums of several quadrature functions in a single
+/// pass over each quadrature function. Only the comps[k].second components starting at
+/// component comps[k].first of the kth quadrature function are summed. The volume is computed
+/// once and stored in data[0], and it's followed by the sums of each quadrature function's
+/// components in the order the quadrature functions are provided in. So, data needs to be
+/// of size 1 + sum(comps[k].second).
+/// If soa[k] is true the kth quadrature function's data is taken to be in a structure of arrays format.
+/// elem_sums is a scratch vector that holds the per element sums, and it is resized as needed.
+//  No MPI communication is done here, so the caller is responsible for the global reduction
+//  of data and for dividing by the volume if a volume average is wanted.
+void ComputeVolSums(const mfem::ParFiniteElementSpace* fes,
+                    const std::vector<const mfem::QuadratureFunction*> &qfs,
+                    const std::vector<std::pair<int, int> > &comps,
+                    const std::vector<bool> &soa,
+                    mfem::Vector &elem_sums,
+                    double* data);
 }
 }
 #endif
@@ -2,6 +2,7 @@
 #define MECHANICS_MODEL
 
 #include "mfem.hpp"
+#include "RAJA/RAJA.hpp"
 
 #include <utility>
 #include <unordered_map>
@@ -47,6 +48,10 @@ class ExaModel
       // beginning of the step and end (or incrementally updated) step.
       mfem::QuadratureFunction *matVars0;
       mfem::QuadratureFunction *matVars1;
+      // Whether the state variables are stored in a structure of arrays (field-major)
+      // format rather than the default quadrature function format where all
+      // of the state variables for a point are next to each other.
+      bool soa_state_vars;
 
       // Stores the von Mises / hydrostatic scalar stress measure
       // we use this array to compute both the hydro and von Mises stress quantities
@@ -78,6 +83,7 @@ class ExaModel
          matGrad(q_matGrad),
          matVars0(q_matVars0),
          matVars1(q_matVars1),
+         soa_state_vars(false),
          matProps(props),
          PA(_PA)
       {
@@ -153,8 +159,27 @@ class ExaModel
       mfem::QuadratureFunction *GetVonMises() { return vonMises; }
 
       /// return a pointer to the matVars0 quadrature function
+      /// Note: the data should be accessed using GetStateVarsLayout as it
+      /// might not be in the usual quadrature function ordering.
       mfem::QuadratureFunction *GetMatVars0() { return matVars0; }
 
+      /// returns whether or not the state variables are stored in a structure of arrays format
+      bool IsStateVarsSoA() const { return soa_state_vars; }
+
+      /// returns the layout of the state variable quadrature functions where the
+      /// first index is the state variable and the second index is the quadrature point
+      RAJA::Layout<2> GetStateVarsLayout() const
+      {
+         const int vdim = matVars0->GetVDim();
+         const int npts = matVars0->Size() / vdim;
+         // The last index in the permutation is the stride 1 index
+         std::array<RAJA::idx_t, 2> perm {{ 1, 0 } };
+         if (soa_state_vars) {
+            perm = {{ 0, 1 } };
+         }
+         return RAJA::make_permuted_layout({{ vdim, npts } }, perm);
+      }
+
       /// return a pointer to the matGrad quadrature function
       mfem::QuadratureFunction *GetMatGrad() { return matGrad; }
 
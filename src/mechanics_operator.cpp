@@ -25,7 +25,8 @@ NonlinearMechOperator::NonlinearMechOperator(ParFiniteElementSpace &fes,
                                              ParGridFunction &end_crds,
                                              Vector &matProps,
                                              int nStateVars)
-   : NonlinearForm(&fes), fe_space(fes), x_ref(ref_crds), x_cur(end_crds)
+   : NonlinearForm(&fes), fe_space(fes), x_ref(ref_crds), x_cur(end_crds),
+   local_grad(nullptr), full_grad(Operator::Hypre_ParCSR)
 {
    CALI_CXX_MARK_SCOPE("mechop_class_setup");
    Vector * rhs;
@@ -55,7 +56,9 @@ NonlinearMechOperator::NonlinearMechOperator(ParFiniteElementSpace &fes,
       // to our initial mesh when 1st created.
       model = new AbaqusUmatModel(&q_sigma0, &q_sigma1, &q_matGrad, &q_matVars0, &q_matVars1,
                                   &q_kinVars0, &beg_crds, &end_crds,
-                                  &matProps, options.nProps, nStateVars, &fes, partial_assembly);
+                                  &matProps, options.nProps, nStateVars, &fes, partial_assembly,
+                                  options.max_substeps, options.umat_reentrant,
+                                  options.umat_batch_size);
 
       // Add the user defined integrator
       if (options.integ_type == IntegrationType::FULL) {
@@ -92,7 +95,9 @@ NonlinearMechOperator::NonlinearMechOperator(ParFiniteElementSpace &fes,
             model = new VoceFCCModel(&q_sigma0, &q_sigma1, &q_matGrad, &q_matVars0, &q_matVars1,
                                      &beg_crds, &end_crds,
                                      &matProps, options.nProps, nStateVars, options.temp_k, accel,
-                                     partial_assembly);
+                                     partial_assembly, options.chunk_size,
+                                     options.dyn_sched, options.cost_sort, options.soa_state_vars,
+                                     options.screen_frac, options.max_substeps, options.substep_evals);
 
             // Add the user defined integrator
             if (options.integ_type == IntegrationType::FULL) {
@@ -109,7 +114,9 @@ NonlinearMechOperator::NonlinearMechOperator(ParFiniteElementSpace &fes,
             model = new VoceNLFCCModel(&q_sigma0, &q_sigma1, &q_matGrad, &q_matVars0, &q_matVars1,
                                        &beg_crds, &end_crds,
                                        &matProps, options.nProps, nStateVars, options.temp_k, accel,
-                                       partial_assembly);
+                                       partial_assembly, options.chunk_size,
+                                       options.dyn_sched, options.cost_sort, options.soa_state_vars,
+                                       options.screen_frac, options.max_substeps, options.substep_evals);
 
             // Add the user defined integrator
             if (options.integ_type == IntegrationType::FULL) {
@@ -126,7 +133,9 @@ NonlinearMechOperator::NonlinearMechOperator(ParFiniteElementSpace &fes,
             model = new KinKMBalDDFCCModel(&q_sigma0, &q_sigma1, &q_matGrad, &q_matVars0, &q_matVars1,
                                            &beg_crds, &end_crds,
                                            &matProps, options.nProps, nStateVars, options.temp_k, accel,
-                                           partial_assembly);
+                                           partial_assembly, options.chunk_size,
+                                           options.dyn_sched, options.cost_sort, options.soa_state_vars,
+                                           options.screen_frac, options.max_substeps, options.substep_evals);
 
             // Add the user defined integrator
             if (options.integ_type == IntegrationType::FULL) {
@@ -145,7 +154,9 @@ NonlinearMechOperator::NonlinearMechOperator(ParFiniteElementSpace &fes,
             model = new KinKMBalDDHCPModel(&q_sigma0, &q_sigma1, &q_matGrad, &q_matVars0, &q_matVars1,
                                            &beg_crds, &end_crds,
                                            &matProps, options.nProps, nStateVars, options.temp_k, accel,
-                                           partial_assembly);
+                                           partial_assembly, options.chunk_size,
+                                           options.dyn_sched, options.cost_sort, options.soa_state_vars,
+                                           options.screen_frac, options.max_substeps, options.substep_evals);
 
             // Add the user defined integrator
             if (options.integ_type == IntegrationType::FULL) {
@@ -165,7 +176,9 @@ NonlinearMechOperator::NonlinearMechOperator(ParFiniteElementSpace &fes,
             model = new VoceBCCModel(&q_sigma0, &q_sigma1, &q_matGrad, &q_matVars0, &q_matVars1,
                                      &beg_crds, &end_crds,
                                      &matProps, options.nProps, nStateVars, options.temp_k, accel,
-                                     partial_assembly);
+                                     partial_assembly, options.chunk_size,
+                                     options.dyn_sched, options.cost_sort, options.soa_state_vars,
+                                     options.screen_frac, options.max_substeps, options.substep_evals);
 
             // Add the user defined integrator
             if (options.integ_type == IntegrationType::FULL) {
@@ -182,7 +195,9 @@ NonlinearMechOperator::NonlinearMechOperator(ParFiniteElementSpace &fes,
             model = new VoceNLBCCModel(&q_sigma0, &q_sigma1, &q_matGrad, &q_matVars0, &q_matVars1,
                                        &beg_crds, &end_crds,
                                        &matProps, options.nProps, nStateVars, options.temp_k, accel,
-                                       partial_assembly);
+                                       partial_assembly, options.chunk_size,
+                                       options.dyn_sched, options.cost_sort, options.soa_state_vars,
+                                       options.screen_frac, options.max_substeps, options.substep_evals);
 
             // Add the user defined integrator
             if (options.integ_type == IntegrationType::FULL) {
@@ -199,7 +214,9 @@ NonlinearMechOperator::NonlinearMechOperator(ParFiniteElementSpace &fes,
             model = new KinKMbalDDBCCModel(&q_sigma0, &q_sigma1, &q_matGrad, &q_matVars0, &q_matVars1,
                                            &beg_crds, &end_crds,
                                            &matProps, options.nProps, nStateVars, options.temp_k, accel,
-                                           partial_assembly);
+                                           partial_assembly, options.chunk_size,
+                                           options.dyn_sched, options.cost_sort, options.soa_state_vars,
+                                           options.screen_frac, options.max_substeps, options.substep_evals);
 
             // Add the user defined integrator
             if (options.integ_type == IntegrationType::FULL) {
@@ -226,6 +243,14 @@ NonlinearMechOperator::NonlinearMechOperator(ParFiniteElementSpace &fes,
       diag = 1.0;
       prec_oper = new MechOperatorJacobiSmoother(diag, Hform->GetEssentialTrueDofs());
    }
+   else {
+      // The residual is evaluated far more often than the Jacobian (line searches,
+      // convergence checks, ...), so we make use of the batched PA residual kernels
+      // here as well. The element matrices of the Jacobian come from the EA kernels
+      // which are thread-parallel over elements, and they're then gathered into a sparse matrix.
+      pa_oper = new EANonlinearMechOperatorGradExt(Hform, Hform->GetEssentialTrueDofs());
+      prec_oper = nullptr;
+   }
 
    // So, we're going to originally support non tensor-product type elements originally.
    const ElementDofOrdering ordering = ElementDofOrdering::NATIVE;
@@ -298,8 +323,12 @@ void NonlinearMechOperator::Mult(const Vector &k, Vector &y) const
    Setup<true>(k);
    // We now perform our element vector operation.
    if (assembly == Assembly::FULL) {
-      CALI_CXX_MARK_SCOPE("mechop_HformMult");
-      Hform->Mult(k, y);
+      CALI_MARK_BEGIN("mechop_FULLsetup");
+      // Only the stress terms are needed for the residual
+      pa_oper->AssembleResidual();
+      CALI_MARK_END("mechop_FULLsetup");
+      CALI_CXX_MARK_SCOPE("mechop_FULLMult");
+      pa_oper->MultVec(k, y);
    }
    else if (assembly == Assembly::PA) {
       CALI_MARK_BEGIN("mechop_PAsetup");
@@ -360,6 +389,11 @@ void NonlinearMechOperator::Setup(const Vector &k) const
 } // End of model setup
 
 void NonlinearMechOperator::SetupJacobianTerms() const
+{
+   SetupJacobianTerms(el_jac);
+}
+
+void NonlinearMechOperator::SetupJacobianTerms(mfem::Vector &jacobian) const
 {
 
    Mesh *mesh = fe_space.GetMesh();
@@ -376,64 +410,146 @@ void NonlinearMechOperator::SetupJacobianTerms() const
    const GeometricFactors *geom = mesh->GetGeometricFactors(*ir, GeometricFactors::JACOBIANS);
    // geom->J really isn't going to work for us as of right now. We could just reorder it
    // to the version that we want it to be in instead...
-
-   const int DIM4 = 4;
-   std::array<RAJA::idx_t, DIM4> perm4 {{ 3, 2, 1, 0 } };
-   // bunch of helper RAJA views to make dealing with data easier down below in our kernel.
-   RAJA::Layout<DIM4> layout_jacob = RAJA::make_permuted_layout({{ space_dims, space_dims, nqpts, nelems } }, perm4);
-   RAJA::View<double, RAJA::Layout<DIM4, RAJA::Index_type, 0> > jac_view(el_jac.ReadWrite(), layout_jacob);
-
-   RAJA::Layout<DIM4> layout_geom = RAJA::make_permuted_layout({{ nqpts, space_dims, space_dims, nelems } }, perm4);
-   RAJA::View<const double, RAJA::Layout<DIM4, RAJA::Index_type, 0> > geom_j_view(geom->J.Read(), layout_geom);
-
-   MFEM_FORALL(i, nelems,
-   {
-      const int nqpts_ = nqpts;
-      const int space_dims_ = space_dims;
-      for (int j = 0; j < nqpts_; j++) {
-         for (int k = 0; k < space_dims_; k++) {
-            for (int l = 0; l < space_dims_; l++) {
-               jac_view(l, k, j, i) = geom_j_view(j, l, k, i);
-            }
-         }
-      }
-   });
+   exaconstit::kernel::jacobian_setup(nqpts, nelems, space_dims, geom->J.Read(), jacobian.Write());
 }
 
 void NonlinearMechOperator::CalculateDeformationGradient(mfem::QuadratureFunction &def_grad) const
 {
-   Mesh *mesh = fe_space.GetMesh();
-
-   //Since we never modify our mesh nodes during this operations this is okay.
-   mfem::GridFunction *nodes = const_cast<mfem::ParGridFunction*>(&x_ref); // set a nodes grid function to global current configuration
-   int owns_nodes = 0;
-   mesh->SwapNodes(nodes, owns_nodes); // pmesh has current configuration nodes
-   SetupJacobianTerms();
-
-   const IntegrationRule *ir = &(IntRules.Get(fe_space.GetFE(0)->GetGeomType(), 2 * fe_space.GetFE(0)->GetOrder() + 1));;
+   CALI_CXX_MARK_SCOPE("mechop_def_grad");
+   const FiniteElement &el = *fe_space.GetFE(0);
+   const IntegrationRule *ir = &(IntRules.Get(el.GetGeomType(), 2 * el.GetOrder() + 1));
 
+   const int space_dims = el.GetDim();
    const int nqpts = ir->GetNPoints();
-   const int ndofs = fe_space.GetFE(0)->GetDof();
+   const int ndofs = el.GetDof();
    const int nelems = fe_space.GetNE();
 
-   Vector x_true(fe_space.TrueVSize(), mfem::Device::GetMemoryType());
+   // The reference configuration Jacobians never change, so they only need to be computed
+   // the first time through. The reference shape function gradients are already saved off
+   // in qpts_dshape.
+   if (ref_el_jac.Size() == 0) {
+      Mesh *mesh = fe_space.GetMesh();
+      ref_el_jac.SetSize(space_dims * space_dims * nqpts * nelems, Device::GetMemoryType());
+      ref_el_jac.UseDevice(true);
+
+      //Since we never modify our mesh nodes during this operations this is okay.
+      mfem::GridFunction *nodes = const_cast<mfem::ParGridFunction*>(&x_ref); // set a nodes grid function to global current configuration
+      int owns_nodes = 0;
+      mesh->SwapNodes(nodes, owns_nodes); // pmesh has current configuration nodes
+      SetupJacobianTerms(ref_el_jac);
+
+      //We're returning our mesh nodes to the original object they were pointing to.
+      //So, we need to cast away the const here.
+      //We just don't want other functions outside this changing things.
+      nodes = const_cast<mfem::ParGridFunction*>(&x_cur);
+      mesh->SwapNodes(nodes, owns_nodes);
+      //Delete the old geometric factors since they dealt with the original reference frame.
+      mesh->DeleteGeometricFactors();
+   }
 
-   x_cur.GetTrueDofs(x_true);
-   // Takes in k vector and transforms into into our E-vector array
-   P->Mult(x_true, px);
-   elem_restrict_lex->Mult(px, el_x);
+   // The current coordinates are already an L-vector, so they can go straight to our E-vector array
+   elem_restrict_lex->Mult(x_cur, el_x);
 
-   def_grad = 0.0;
-   exaconstit::kernel::grad_calc(nqpts, nelems, ndofs, el_jac.Read(), qpts_dshape.Read(), el_x.Read(), def_grad.ReadWrite());
+   exaconstit::kernel::grad_calc(nqpts, nelems, ndofs, ref_el_jac.Read(), qpts_dshape.Read(), el_x.Read(), def_grad.Write());
+}
 
-   //We're returning our mesh nodes to the original object they were pointing to.
-   //So, we need to cast away the const here.
-   //We just don't want other functions outside this changing things.
-   nodes = const_cast<mfem::ParGridFunction*>(&x_cur);
-   mesh->SwapNodes(nodes, owns_nodes);
-   //Delete the old geometric factors since they dealt with the original reference frame.
-   mesh->DeleteGeometricFactors();
+void NonlinearMechOperator::AssembleFullGradient() const
+{
+   CALI_CXX_MARK_SCOPE("mechop_FULL_assembleGrad");
+   // Element matrices: each element is handled by a single thread and writes
+   // only to its own block of the ea_data array. Our callers have already run
+   // AssembleResidual for the current model state, so only the EA pass is needed here.
+   auto ea_oper = static_cast<EANonlinearMechOperatorGradExt*>(pa_oper);
+   ea_oper->AssembleGradient();
+   const Vector &ea_data = ea_oper->GetElementMatrices();
 
+   const int nelems = fe_space.GetNE();
+   const int elem_dofs = fe_space.GetFE(0)->GetDof() * fe_space.GetFE(0)->GetDim();
+   const int elem_dofs2 = elem_dofs * elem_dofs;
+
+   // The sparsity pattern doesn't change during the simulation, so we only need to
+   // form it and the nonzero to element matrix entries map once.
+   if (local_grad == nullptr) {
+      CALI_CXX_MARK_SCOPE("mechop_FULL_sparsity");
+      local_grad = new SparseMatrix(fe_space.GetVSize());
+      Array<int> vdofs;
+      for (int ie = 0; ie < nelems; ie++) {
+         fe_space.GetElementVDofs(ie, vdofs);
+         for (int j = 0; j < elem_dofs; j++) {
+            for (int i = 0; i < elem_dofs; i++) {
+               local_grad->Add(vdofs[j], vdofs[i], 0.0);
+            }
+         }
+      }
+      // We need to keep all of the zero entries around for our structure
+      local_grad->Finalize(0);
+
+      const int nnz = local_grad->NumNonZeroElems();
+      const int *I = local_grad->GetI();
+      const int *J = local_grad->GetJ();
+      auto find_nnz = [&](const int row, const int col) -> int {
+         for (int k = I[row]; k < I[row + 1]; k++) {
+            if (J[k] == col) { return k; }
+         }
+         MFEM_ABORT("Could not find entry for row = " << row << ", col = " << col);
+         return -1;
+      };
+
+      grad_offsets.SetSize(nnz + 1);
+      grad_offsets = 0;
+      grad_indices.SetSize(nelems * elem_dofs2);
+      // The element matrices act as y_j = A_ij x_i so A(i, j, e) ends up in
+      // row vdofs[j] and column vdofs[i] of our sparse matrix.
+      for (int ie = 0; ie < nelems; ie++) {
+         fe_space.GetElementVDofs(ie, vdofs);
+         for (int j = 0; j < elem_dofs; j++) {
+            for (int i = 0; i < elem_dofs; i++) {
+               grad_offsets[find_nnz(vdofs[j], vdofs[i]) + 1] += 1;
+            }
+         }
+      }
+      for (int k = 0; k < nnz; k++) {
+         grad_offsets[k + 1] += grad_offsets[k];
+      }
+      Array<int> fill(nnz);
+      fill = 0;
+      for (int ie = 0; ie < nelems; ie++) {
+         fe_space.GetElementVDofs(ie, vdofs);
+         for (int j = 0; j < elem_dofs; j++) {
+            for (int i = 0; i < elem_dofs; i++) {
+               const int k = find_nnz(vdofs[j], vdofs[i]);
+               grad_indices[grad_offsets[k] + fill[k]] = i + elem_dofs * j + elem_dofs2 * ie;
+               fill[k] += 1;
+            }
+         }
+      }
+   }
+
+   {
+      CALI_CXX_MARK_SCOPE("mechop_FULL_gather");
+      // FULL assembly is never run on the GPU so everything here lives on the host.
+      // Each nonzero is owned by a single thread which makes this race free.
+      const int nnz = local_grad->NumNonZeroElems();
+      const int *offsets = grad_offsets.HostRead();
+      const int *indices = grad_indices.HostRead();
+      const double *EA = ea_data.HostRead();
+      double *A = local_grad->GetData();
+      MFEM_FORALL(k, nnz, {
+         double sum = 0.0;
+         for (int l = offsets[k]; l < offsets[k + 1]; l++) {
+            sum += EA[indices[l]];
+         }
+         A[k] = sum;
+      });
+   }
+
+   // Same as what's done in ParNonlinearForm::GetGradient
+   OperatorHandle dA(Operator::Hypre_ParCSR), Ph(Operator::Hypre_ParCSR);
+   dA.MakeSquareBlockDiag(fe_space.GetComm(), fe_space.GlobalVSize(),
+                          fe_space.GetDofOffsets(), local_grad);
+   Ph.ConvertFrom(fe_space.Dof_TrueDof_Matrix());
+   full_grad.Clear();
+   full_grad.MakePtAP(dA, Ph);
 }
 
 // Update the end coords used in our model
@@ -447,7 +563,10 @@ Operator &NonlinearMechOperator::GetGradient(const Vector &x) const
 {
    CALI_CXX_MARK_SCOPE("mechop_getgrad");
    if (assembly == Assembly::FULL) {
-      Jacobian = &Hform->GetGradient(x);
+      AssembleFullGradient();
+      // Apply the essential boundary conditions
+      OperatorHandle Je(full_grad.As<HypreParMatrix>()->EliminateRowsCols(ess_tdof_list));
+      Jacobian = full_grad.Ptr();
       return *Jacobian;
    }
    else {
@@ -472,11 +591,14 @@ Operator& NonlinearMechOperator::GetUpdateBCsAction(const Vector &k, const Vecto
    // We now perform our element vector operation.
    Vector resid(y); resid.UseDevice(true);
    if (assembly == Assembly::FULL) {
-      CALI_CXX_MARK_SCOPE("mechop_Hform_LocalGrad");
-      auto &loc_jacobian = Hform->GetLocalGradient2(x);
-      loc_jacobian.Mult(x, y);
-      Hform->Mult(k, resid);;
-      Jacobian = &Hform->GetGradient(x);
+      CALI_CXX_MARK_SCOPE("mechop_FULL_LocalGrad");
+      pa_oper->AssembleResidual();
+      pa_oper->MultVec(k, resid);
+      AssembleFullGradient();
+      // Local action of the Jacobian before any of the BCs are applied
+      full_grad.Ptr()->Mult(x, y);
+      OperatorHandle Je(full_grad.As<HypreParMatrix>()->EliminateRowsCols(ess_tdof_list));
+      Jacobian = full_grad.Ptr();
    }
    else if (assembly == Assembly::PA) {
       CALI_MARK_BEGIN("mechop_PAsetup");
@@ -514,10 +636,9 @@ NonlinearMechOperator::~NonlinearMechOperator()
 {
    delete model;
    delete Hform;
-   if (assembly != Assembly::FULL) {
-      delete pa_oper;
-      // This will be deleted in the system driver class
-      // before the preconditioner is deleted.
-      // delete prec_oper;
-   }
+   delete pa_oper;
+   delete local_grad;
+   // prec_oper will be deleted in the system driver class
+   // before the preconditioner is deleted.
+   // delete prec_oper;
 }
@@ -20,12 +20,23 @@ class NonlinearMechOperator : public mfem::NonlinearForm
       mfem::ParFiniteElementSpace &fe_space;
       mfem::ParNonlinearForm *Hform;
       mutable mfem::Vector diag, qpts_dshape, el_x, px, el_jac;
+      // The Jacobians of the reference configuration used for the deformation gradient
+      mutable mfem::Vector ref_el_jac;
       mutable mfem::Operator *Jacobian;
       const mfem::Vector *x;
       const mfem::ParGridFunction &x_ref;
       const mfem::ParGridFunction &x_cur;
       mutable PANonlinearMechOperatorGradExt *pa_oper;
       mutable MechOperatorJacobiSmoother *prec_oper;
+      // The FULL assembly Jacobian is built from the EA element matrices.
+      // local_grad is the unconstrained local sparse matrix and grad_offsets/grad_indices
+      // map each of its nonzeros to the element matrix entries that contribute to it.
+      // The element matrices and the nelems * elem_dofs^2 index map are kept around between
+      // assemblies, so FULL assembly uses roughly twice the memory of the sparse matrix alone
+      // in exchange for a race free thread parallel gather.
+      mutable mfem::SparseMatrix *local_grad;
+      mutable mfem::OperatorHandle full_grad;
+      mutable mfem::Array<int> grad_offsets, grad_indices;
       const mfem::Operator *elem_restrict_lex;
       Assembly assembly;
       /// nonlinear model
@@ -74,6 +85,14 @@ class NonlinearMechOperator : public mfem::NonlinearForm
       void Setup(const mfem::Vector &k) const;
 
       void SetupJacobianTerms() const;
+      /// Computes the element Jacobians of the mesh's current nodes and stores them in jacobian
+      void SetupJacobianTerms(mfem::Vector &jacobian) const;
+
+      /// Assembles the unconstrained parallel Jacobian for the FULL assembly path.
+      /// The element matrices are computed by the thread-parallel EA kernels and then
+      /// gathered into the local sparse matrix one nonzero at a time, so no two threads
+      /// ever write to the same location.
+      void AssembleFullGradient() const;
       void CalculateDeformationGradient(mfem::QuadratureFunction &def_grad) const;
 
       // We need the solver to update the end coords after each iteration has been complete
@@ -92,6 +92,16 @@ void PANonlinearMechOperatorGradExt::Assemble()
    }
 }
 
+void PANonlinearMechOperatorGradExt::AssembleResidual()
+{
+   CALI_CXX_MARK_SCOPE("PA_AssembleResidual");
+   Array<NonlinearFormIntegrator*> &integrators = *oper_mech->GetDNFI();
+   const int num_int = integrators.Size();
+   for (int i = 0; i < num_int; ++i) {
+      integrators[i]->AssemblePA(*oper_mech->FESpace());
+   }
+}
+
 void PANonlinearMechOperatorGradExt::AssembleDiagonal(Vector &diag)
 {
    CALI_CXX_MARK_SCOPE("AssembleDiagonal");
@@ -225,6 +235,18 @@ void EANonlinearMechOperatorGradExt::Assemble()
    }
 }
 
+void EANonlinearMechOperatorGradExt::AssembleGradient()
+{
+   ea_data = 0.0;
+
+   CALI_CXX_MARK_SCOPE("EA_AssembleGradient");
+   Array<NonlinearFormIntegrator*> &integrators = *oper_mech->GetDNFI();
+   const int num_int = integrators.Size();
+   for (int i = 0; i < num_int; ++i) {
+      integrators[i]->AssembleEA(*oper_mech->FESpace(), ea_data);
+   }
+}
+
 void EANonlinearMechOperatorGradExt::AssembleDiagonal(Vector &diag)
 {
    CALI_CXX_MARK_SCOPE("eaAssembleDiagonal");
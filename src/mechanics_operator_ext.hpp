@@ -41,6 +41,11 @@ class PANonlinearMechOperatorGradExt : public NonlinearMechOperatorExt
                                      const mfem::Array<int> &ess_tdofs);
 
       virtual void Assemble();
+      /// Only assembles the quadrature point data needed by the residual
+      /// action (MultVec). This allows the FULL assembly path to evaluate
+      /// the residual with the batched PA kernels while the Jacobian itself
+      /// is still assembled element by element.
+      void AssembleResidual();
       virtual void AssembleDiagonal(mfem::Vector &diag);
       template<bool local_action>
       void TMult(const mfem::Vector &x, mfem::Vector &y) const;
@@ -64,8 +69,14 @@ class EANonlinearMechOperatorGradExt : public PANonlinearMechOperatorGradExt
                                      const mfem::Array<int> &ess_tdofs);
 
       void Assemble();
+      /// Only computes the element matrices. The PA data they're built from must already
+      /// be current through a call to AssembleResidual or Assemble after the latest model update.
+      void AssembleGradient();
 
       void AssembleDiagonal(mfem::Vector &diag);
+      /// Returns the element matrices computed during the last Assemble call.
+      /// They are laid out as (elemDofs, elemDofs, NE).
+      const mfem::Vector &GetElementMatrices() const { return ea_data; }
       // using PANonlinearMechOperatorGradExt::AssembleDiagonal;
       template<bool local_action>
       void TMult(const mfem::Vector &x, mfem::Vector &y) const;
@@ -2,140 +2,220 @@
 #include "BCManager.hpp"
 #include <math.h> // log
 #include <algorithm>
+#include <vector>
 #include <iostream> // cerr
 #include "RAJA/RAJA.hpp"
+#include "mechanics_kernels.hpp"
+#include "mfem/general/forall.hpp"
 
 using namespace mfem;
 using namespace std;
 
-void AbaqusUmatModel::UpdateModelVars()
+namespace {
+
+// All of the 3x3 matrices below are stored in column major order just like mfem::DenseMatrix,
+// and they only make use of stack memory so they're safe to call from within threaded regions.
+
+// det(A)
+inline double Det3x3(const double* A)
 {
-   // update the beginning step deformation gradient
-   QuadratureFunction* defGrad = defGrad0;
-   double* dgrad0 = defGrad->HostReadWrite();
-   double* dgrad1 = end_def_grad.HostReadWrite();
-   // We just need to update our beginning of time step def. grad. with our
-   // end step def. grad. now that they are equal.
-   for (int i = 0; i < defGrad->Size(); i++) {
-      dgrad0[i] = dgrad1[i];
+   return A[0] * (A[4] * A[8] - A[5] * A[7]) -
+          A[3] * (A[1] * A[8] - A[2] * A[7]) +
+          A[6] * (A[1] * A[5] - A[2] * A[4]);
+}
+
+// Ainv = A^-1
+inline void Invert3x3(const double* A, double* Ainv)
+{
+   const double idet = 1.0 / Det3x3(A);
+   Ainv[0] = idet * (A[4] * A[8] - A[7] * A[5]);
+   Ainv[1] = idet * (A[7] * A[2] - A[1] * A[8]);
+   Ainv[2] = idet * (A[1] * A[5] - A[4] * A[2]);
+   Ainv[3] = idet * (A[6] * A[5] - A[3] * A[8]);
+   Ainv[4] = idet * (A[0] * A[8] - A[6] * A[2]);
+   Ainv[5] = idet * (A[3] * A[2] - A[0] * A[5]);
+   Ainv[6] = idet * (A[3] * A[7] - A[6] * A[4]);
+   Ainv[7] = idet * (A[6] * A[1] - A[0] * A[7]);
+   Ainv[8] = idet * (A[0] * A[4] - A[3] * A[1]);
+}
+
+// C = A B
+inline void Mult3x3(const double* A, const double* B, double* C)
+{
+   for (int j = 0; j < 3; j++) {
+      for (int i = 0; i < 3; i++) {
+         C[i + 3 * j] = A[i] * B[3 * j] + A[i + 3] * B[1 + 3 * j] + A[i + 6] * B[2 + 3 * j];
+      }
    }
 }
 
-// Work through the initialization of all of this...
-void AbaqusUmatModel::init_loc_sf_grads(ParFiniteElementSpace *fes)
+// Eulerian strain which is given as:
+// e = 1/2 (I - B^(-1)) = 1/2 (I - F(^-T)F^(-1))
+inline void CalcEulerianStrain3x3(const double* F, double* E)
 {
-   const FiniteElement *fe;
-   const IntegrationRule *ir;
-   QuadratureFunction* _defgrad0 = defGrad0;
-   QuadratureSpace* qspace = _defgrad0->GetSpace();
+   double Finv[9];
+   Invert3x3(F, Finv);
+   for (int j = 0; j < 3; j++) {
+      for (int i = 0; i < 3; i++) {
+         E[i + 3 * j] = -0.5 * (Finv[3 * i] * Finv[3 * j] + Finv[1 + 3 * i] * Finv[1 + 3 * j] +
+                                Finv[2 + 3 * i] * Finv[2 + 3 * j]);
+      }
+      E[j + 3 * j] += 0.5;
+   }
+}
 
-   ir = &(qspace->GetElementIntRule(0));
+// Finds the rotation portion of the polar decomposition of F using the same iterative
+// method as ExaModel::CalcPolarDecompDefGrad. Since this is only used for incremental
+// deformation gradients, the iterations start from the identity matrix.
+void CalcPolarRot3x3(const double* F, double* R, const double err = 1e-12)
+{
+   const int max_iter = 500;
+   const double* ac1 = &F[0];
+   const double* ac2 = &F[3];
+   const double* ac3 = &F[6];
 
-   const int NE = fes->GetNE();
-   const int NQPTS = ir->GetNPoints();
+   for (int i = 0; i < 9; i++) {
+      R[i] = 0.0;
+   }
+   R[0] = 1.0; R[4] = 1.0; R[8] = 1.0;
+
+   for (int iter = 0; iter < max_iter; iter++) {
+      // The dot products that show up in the paper
+      const double r1da1 = R[0] * ac1[0] + R[1] * ac1[1] + R[2] * ac1[2];
+      const double r2da2 = R[3] * ac2[0] + R[4] * ac2[1] + R[5] * ac2[2];
+      const double r3da3 = R[6] * ac3[0] + R[7] * ac3[1] + R[8] * ac3[2];
+
+      // The summed cross products that show up in the paper
+      double w[3];
+      w[0] = (-R[2] * ac1[1] + R[1] * ac1[2]) +
+             (-R[5] * ac2[1] + R[4] * ac2[2]) +
+             (-R[8] * ac3[1] + R[7] * ac3[2]);
+
+      w[1] = (R[2] * ac1[0] - R[0] * ac1[2]) +
+             (R[5] * ac2[0] - R[3] * ac2[2]) +
+             (R[8] * ac3[0] - R[6] * ac3[2]);
+
+      w[2] = (-R[1] * ac1[0] + R[0] * ac1[1]) +
+             (-R[4] * ac2[0] + R[3] * ac2[1]) +
+             (-R[7] * ac3[0] + R[6] * ac3[1]);
+
+      const double w_bot = (1.0 / (fabs(r1da1 + r2da2 + r3da3) + err));
+      // The axial vector that shows up in the paper
+      w[0] *= w_bot; w[1] *= w_bot; w[2] *= w_bot;
+      // The norm of the axial vector
+      const double w_norm = sqrt(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+      // If the norm is below our desired error we've gotten our solution
+      // So we can break out of the loop
+      if (w_norm < err) {
+         break;
+      }
+      // The exponential mapping for an axial vector
+      const double w_norm_inv = 1.0 / w_norm;
+      const double sth = sin(w_norm) * w_norm_inv;
+      const double cth = (1.0 - cos(w_norm)) * w_norm_inv * w_norm_inv;
 
-   // get element transformation for the 0th element
-   // We just want to get some basic stuff for now
-   fe = fes->GetFE(0);
+      double omega[9];
+      omega[0] = 1.0 - cth * (w[2] * w[2] + w[1] * w[1]);
+      omega[4] = 1.0 - cth * (w[2] * w[2] + w[0] * w[0]);
+      omega[8] = 1.0 - cth * (w[1] * w[1] + w[0] * w[0]);
 
-   // declare data to store shape function gradients
-   // and element Jacobians
-   DenseMatrix Jrt, DSh, DS;
-   int dof = fe->GetDof(), dim = fe->GetDim();
-   const int VDIM = dof * dim;
+      omega[3] = -sth * w[2] + cth * w[1] * w[0];
+      omega[6] = sth * w[1] + cth * w[2] * w[0];
 
-   DSh.SetSize(dof, dim);
-   // This should probably be linked to the underlying quadrature function
-   DS.SetSize(dof, dim);
-   Jrt.SetSize(dim);
+      omega[1] = sth * w[2] + cth * w[0] * w[1];
+      omega[7] = -sth * w[0] + cth * w[2] * w[1];
 
-   // We now have enough information to create our loc0_sf_grad
+      omega[2] = -sth * w[1] + cth * w[0] * w[2];
+      omega[5] = sth * w[0] + cth * w[2] * w[1];
 
-   loc0_sf_grad.SetSpace(qspace, VDIM);
-   double* data = loc0_sf_grad.HostReadWrite();
+      double temp[9];
+      Mult3x3(omega, R, temp);
+      for (int i = 0; i < 9; i++) {
+         R[i] = temp[i];
+      }
+   }
+}
 
-   // loop over elements
-   for (int i = 0; i < NE; ++i) {
-      // get element transformation for the ith element
-      ElementTransformation* Ttr = fes->GetElementTransformation(i);
-      fe = fes->GetFE(i);
+} // End private namespace
 
-      // PMatI.UseExternalData(el_x.ReadWrite(), dof, dim);
+void AbaqusUmatModel::UpdateModelVars()
+{
+   // update the beginning step deformation gradient
+   // We just need to update our beginning of time step def. grad. with our
+   // end step def. grad. now that they are equal.
+   const int size = defGrad0->Size();
+   const double* dgrad1 = end_def_grad.Read();
+   double* dgrad0 = defGrad0->Write();
+   MFEM_FORALL(i, size, {
+      dgrad0[i] = dgrad1[i];
+   });
+}
+
+// The deformation gradient is the gradient of the current coordinates with respect to the
+// reference coordinates. So, we only need the Jacobians of the reference configuration which
+// are saved off here, and then the same kernel used for the velocity gradient gives us the
+// deformation gradient.
+void AbaqusUmatModel::init_loc_sf_grads(ParFiniteElementSpace *fes)
+{
+   const IntegrationRule *ir = &(defGrad0->GetSpace()->GetElementIntRule(0));
+   Mesh *mesh = fes->GetMesh();
 
-      ir = &(qspace->GetElementIntRule(i));
+   const int space_dims = fes->GetFE(0)->GetDim();
+   const int nqpts = ir->GetNPoints();
+   const int nelems = fes->GetNE();
 
-      // loop over integration points where the quadrature function is
-      // stored
-      for (int j = 0; j < NQPTS; ++j) {
-         // The offset is the current location of the data
-         int offset = (i * NQPTS * VDIM) + (j * VDIM);
-         double* data_offset = data + offset;
+   ref_jacobian.SetSize(space_dims * space_dims * nqpts * nelems, Device::GetMemoryType());
+   ref_jacobian.UseDevice(true);
 
-         DS.UseExternalData(data_offset, dof, dim);
+   // The mesh is still in its reference configuration when the model is created
+   mesh->DeleteGeometricFactors();
+   const GeometricFactors *geom = mesh->GetGeometricFactors(*ir, GeometricFactors::JACOBIANS);
 
-         const IntegrationPoint &ip = ir->IntPoint(j);
-         Ttr->SetIntPoint(&ip);
-         CalcInverse(Ttr->Jacobian(), Jrt);
+   exaconstit::kernel::jacobian_setup(nqpts, nelems, space_dims, geom->J.Read(), ref_jacobian.Write());
+   mesh->DeleteGeometricFactors();
 
-         fe->CalcDShape(ip, DSh);
-         Mult(DSh, Jrt, DS);
-      }
-   }
+   // The end coordinates are transformed to an E-vector with this
+   elem_restrict = fes->GetElementRestriction(ElementDofOrdering::NATIVE);
+   el_x.SetSize(elem_restrict->Height(), Device::GetMemoryType());
+   el_x.UseDevice(true);
 }
 
 void AbaqusUmatModel::init_incr_end_def_grad()
 {
-   const IntegrationRule *ir;
    QuadratureFunction* _defgrad0 = defGrad0;
    QuadratureSpace* qspace = _defgrad0->GetSpace();
 
-   ir = &(qspace->GetElementIntRule(0));
+   const int npts = qspace->GetSize();
+   const int vdim = _defgrad0->GetVDim();
 
-   const int TOTQPTS = qspace->GetSize();
-   const int NQPTS = ir->GetNPoints();
-   // We've got the same elements everywhere so we can do this.
-   // If this assumption is no longer true we need to update the code
-   const int NE = TOTQPTS / NQPTS;
-   const int VDIM = _defgrad0->GetVDim();
-
-   incr_def_grad.SetSpace(qspace, VDIM);
-   incr_def_grad = 0.0;
-   double* incr_data = incr_def_grad.HostReadWrite();
-
-   end_def_grad.SetSpace(qspace, VDIM);
-   end_def_grad = 0.0;
-   double* end_data = end_def_grad.HostReadWrite();
-
-   // loop over elements
-   for (int i = 0; i < NE; ++i) {
-      // loop over integration points where the quadrature function is
-      // stored
-      for (int j = 0; j < NQPTS; ++j) {
-         // The offset is the current location of the data
-         int offset = (i * NQPTS * VDIM) + (j * VDIM);
-         double* incr_data_offset = incr_data + offset;
-         double* end_data_offset = end_data + offset;
-
-         // It's now just initialized to being the identity matrix
-         incr_data_offset[0] = 1.0;
-         incr_data_offset[4] = 1.0;
-         incr_data_offset[8] = 1.0;
-
-         // It's now just initialized to being the identity matrix
-         end_data_offset[0] = 1.0;
-         end_data_offset[4] = 1.0;
-         end_data_offset[8] = 1.0;
+   incr_def_grad.SetSpace(qspace, vdim);
+   incr_def_grad.UseDevice(true);
+   end_def_grad.SetSpace(qspace, vdim);
+   end_def_grad.UseDevice(true);
+
+   double* incr_data = incr_def_grad.Write();
+   double* end_data = end_def_grad.Write();
+
+   // It's now just initialized to being the identity matrix
+   MFEM_FORALL(i, npts, {
+      for (int j = 0; j < vdim; j++) {
+         incr_data[i * vdim + j] = 0.0;
+         end_data[i * vdim + j] = 0.0;
       }
-   }
+      incr_data[i * vdim] = 1.0;
+      incr_data[i * vdim + 4] = 1.0;
+      incr_data[i * vdim + 8] = 1.0;
+      end_data[i * vdim] = 1.0;
+      end_data[i * vdim + 4] = 1.0;
+      end_data[i * vdim + 8] = 1.0;
+   });
 }
 
-void AbaqusUmatModel::calc_incr_end_def_grad(const Vector &x0)
+void AbaqusUmatModel::calc_incr_end_def_grad(const Vector &loc_grad)
 {
-   const IntegrationRule *ir;
    QuadratureFunction* _defgrad0 = defGrad0;
    QuadratureSpace* qspace = _defgrad0->GetSpace();
-
-   ir = &(qspace->GetElementIntRule(0));
+   const IntegrationRule *ir = &(qspace->GetElementIntRule(0));
 
    const int tot_qpts = qspace->GetSize();
    const int nqpts = ir->GetNPoints();
@@ -143,68 +223,43 @@ void AbaqusUmatModel::calc_incr_end_def_grad(const Vector &x0)
    // If this assumption is no longer true we need to update the code
    const int ne = tot_qpts / nqpts;
    const int vdim = _defgrad0->GetVDim();
-   // We also assume we're only dealing with 3D type elements.
-   // If we aren't then this needs to change...
-   const int dim = 3;
-   const int vdim2 = loc0_sf_grad.GetVDim();
-   const int dof = vdim2 / dim;
-
-   double* incr_data = incr_def_grad.HostReadWrite();
-   double* end_data = end_def_grad.HostReadWrite();
-   double* int_data = _defgrad0->HostReadWrite();
-   double* ds_data = loc0_sf_grad.HostReadWrite();
-
-   ParGridFunction x_gf;
-   // This is quite dangerous potentially and we should try and fix this
-   // maybe with pargrid function or somewhere else
-   double* vals = const_cast<double*>(x0.HostRead());
-
-   x_gf.MakeTRef(loc_fes, vals);
-   x_gf.SetFromTrueVector();
-   x_gf.HostReadWrite();
-
-   DenseMatrix f_incr(dim, dim);
-   DenseMatrix f_end(dim, dim);
-   DenseMatrix f_beg(dim, dim);
-   DenseMatrix f_beg_invr(dim, dim);
-   DenseMatrix DS(dof, dim);
-   DenseMatrix PMatI(dof, dim);
-   // The below are constant but will change between steps
-   Array<int> vdofs(vdim2);
-   Vector el_x(PMatI.Data(), vdim2);
-
-   // loop over elements
-   for (int i = 0; i < ne; ++i) {
-      loc_fes->GetElementVDofs(i, vdofs);
-      // Our PMatI is now updated to the correct elemental values
-      x_gf.GetSubVector(vdofs, el_x);
-      // loop over integration points where the quadrature function is
-      // stored
-      for (int j = 0; j < nqpts; ++j) {
-         // The offset is the current location of the data
-         int offset = (i * nqpts * vdim) + (j * vdim);
-         int offset2 = (i * nqpts * vdim2) + (j * vdim2);
-         double* incr_data_offset = incr_data + offset;
-         double* end_data_offset = end_data + offset;
-         double* int_data_offset = int_data + offset;
-         double* ds_data_offset = ds_data + offset2;
-
-         f_end.UseExternalData(end_data_offset, dim, dim);
-         f_beg.UseExternalData(int_data_offset, dim, dim);
-         f_incr.UseExternalData(incr_data_offset, dim, dim);
-         DS.UseExternalData(ds_data_offset, dof, dim);
-
-         // Get the inverse of the beginning time step def. grad
-         f_beg_invr = f_beg;
-         f_beg_invr.Invert();
-
-         // Find the end time step def. grad
-         MultAtB(PMatI, DS, f_end);
-
-         // Our incremental def. grad is now
-         Mult(f_end, f_beg_invr, f_incr);
+   const int ndofs = loc_fes->GetFE(0)->GetDof();
+
+   // Find the end time step def. grad
+   elem_restrict->Mult(*end_coords, el_x);
+   exaconstit::kernel::grad_calc(nqpts, ne, ndofs, ref_jacobian.Read(), loc_grad.Read(),
+                                 el_x.Read(), end_def_grad.Write());
+
+   const double* end_data = end_def_grad.Read();
+   const double* beg_data = _defgrad0->Read();
+   double* incr_data = incr_def_grad.Write();
+
+   // Our incremental def. grad is now F_incr = F_end F_beg^{-1}
+   // All of these are stored in column major order
+   MFEM_FORALL(i, tot_qpts, {
+      const double* F = &(beg_data[i * vdim]);
+      const double* Fe = &(end_data[i * vdim]);
+      double* Fi = &(incr_data[i * vdim]);
+      const double det = F[0] * (F[4] * F[8] - F[5] * F[7]) -
+                         F[3] * (F[1] * F[8] - F[2] * F[7]) +
+                         F[6] * (F[1] * F[5] - F[2] * F[4]);
+      const double idet = 1.0 / det;
+      double Finv[9];
+      Finv[0] = idet * (F[4] * F[8] - F[7] * F[5]);
+      Finv[1] = idet * (F[7] * F[2] - F[1] * F[8]);
+      Finv[2] = idet * (F[1] * F[5] - F[4] * F[2]);
+      Finv[3] = idet * (F[6] * F[5] - F[3] * F[8]);
+      Finv[4] = idet * (F[0] * F[8] - F[6] * F[2]);
+      Finv[5] = idet * (F[3] * F[2] - F[0] * F[5]);
+      Finv[6] = idet * (F[3] * F[7] - F[6] * F[4]);
+      Finv[7] = idet * (F[6] * F[1] - F[0] * F[7]);
+      Finv[8] = idet * (F[0] * F[4] - F[3] * F[1]);
+      for (int k = 0; k < 3; k++) {
+         for (int j = 0; j < 3; j++) {
+            Fi[j + 3 * k] = Fe[j] * Finv[3 * k] + Fe[j + 3] * Finv[1 + 3 * k] + Fe[j + 6] * Finv[2 + 3 * k];
+         }
       }
-   }
+   });
 }
 
 void AbaqusUmatModel::CalcLogStrainIncrement(DenseMatrix& dE, const DenseMatrix &Jpt)
@@ -304,20 +359,19 @@ void AbaqusUmatModel::CalcLagrangianStrainIncr(DenseMatrix& dE, const DenseMatri
 // Further testing needs to be conducted to make sure this still does everything it used to
 // but it should. Since, it is just copy and pasted from the old EvalModel function and now
 // has loops added to it.
+// All of the per point work only makes use of stack arrays, so if the UMAT is re-entrant
+// the points can be split up across the OpenMP threads.
 void AbaqusUmatModel::ModelSetup(const int nqpts, const int nelems, const int space_dim,
                                  const int /*nnodes*/, const Vector &jacobian,
-                                 const Vector & /*loc_grad*/, const Vector &vel)
+                                 const Vector &loc_grad, const Vector & /*vel*/)
 {
-   // All of this should be scoped to limit at least some of our memory usage
-   {
-      ParGridFunction* end_crds = end_coords;
-      Vector temp;
-      temp.SetSize(vel.Size());
-      end_crds->GetTrueDofs(temp);
-      // Creating a new vector that's going to be used for our
-      // UMAT custom Hform->Mult
-      const Vector crd(temp.HostReadWrite(), temp.Size());
-      calc_incr_end_def_grad(crd);
+   // The end coordinates were already updated from the velocity, so the deformation
+   // gradients only need the local shape function gradients.
+   calc_incr_end_def_grad(loc_grad);
+
+   if (batch_size > 0) {
+      ModelSetupBatched(nqpts, nelems, jacobian);
+      return;
    }
 
    // ======================================================
@@ -328,73 +382,25 @@ void AbaqusUmatModel::ModelSetup(const int nqpts, const int nelems, const int sp
    int ndi = 3; // number of direct stress components
    int nshr = 3; // number of shear stress components
    int ntens = ndi + nshr;
-   int noel = 0;
-   int npt = 0;
-   int layer = 0;
-   int kspt = 0;
-   int kstep = 0;
-   int kinc = 0;
 
    // set properties and state variables length (hard code for now);
    int nprops = numProps;
    int nstatv = numStateVars;
 
-   double pnewdt = 10.0; // revisit this
-   double props[nprops]; // populate from the mat props vector wrapped by matProps on the base class
-   double statev[nstatv]; // populate from the state variables associated with this element/ip
-
-   double rpl = 0.0; // volumetric heat generation per unit time, not considered
-   double drpldt = 0.0; // variation of rpl wrt temperature set to 0.0
-   double tempk = 300.0; // no thermal considered at this point
-   double dtemp = 0.0; // no increment in thermal considered at this point
-   double predef = 0.0; // no interpolated values of predefined field variables at ip point
-   double dpred = 0.0; // no array of increments of predefined field variables
-   double sse = 0.0; // specific elastic strain energy, mainly for output
-   double spd = 0.0; // specific plastic dissipation, mainly for output
-   double scd = 0.0; // specific creep dissipation, mainly for output
-   double cmname = 0.0; // user defined UMAT name
-   double celent = 0.0; // set element length
-
-   // integration point coordinates
-   // a material model shouldn't need this ever
-   double coords[3] = { 0, 0, 0 };
-
-   // set the time step
-   double deltaTime = dt; // set on the ExaModel base class
-
-   // set time. Abaqus has odd increment definition. time[1] is the value of total
-   // time at the beginning of the current increment. Since we are iterating from
-   // tn to tn+1, this is just tn. time[0] is value of step time at the beginning
-   // of the current increment. What is step time if not tn? It seems as though
-   // they sub-increment between tn->tn+1, where there is a Newton Raphson loop
-   // advancing the sub-increment. For now, set time[0] is set to t - dt/
-   double time[2];
-   time[0] = t - dt;
-   time[1] = t;
-
-   double stress[6]; // Cauchy stress at ip
-   double ddsdt[6]; // variation of the stress increments wrt to temperature, set to 0.0
-   double drplde[6]; // variation of rpl wrt strain increments, set to 0.0
-   double stran[6]; // array containing total strains at beginning of the increment
-   double dstran[6]; // array of strain increments
-
-   double *drot; // rotation matrix for finite deformations
-   double dfgrd0[9]; // deformation gradient at beginning of increment
-   double dfgrd1[9]; // defomration gradient at the end of the increment.
-                     // set to zero if nonlinear geometric effects are not
-                     // included in the step as is the case for ExaConstit
-
-   QuadratureFunction* _defgrad0 = defGrad0;
-
-   double* defgrad0 = _defgrad0->HostReadWrite();
-   double* defgrad1 = end_def_grad.HostReadWrite();
-   double* incr_defgrad = incr_def_grad.HostReadWrite();
-   DenseMatrix incr_dgrad, dgrad0, dgrad1;
-
    const int vdim = end_def_grad.GetVDim();
-   double ddsdde[36]; // output Jacobian matrix of the constitutive model.
-                      // ddsdde(i,j) defines the change in the ith stress component
-                      // due to an incremental perturbation in the jth strain increment
+   const int npts = nqpts * nelems;
+
+   // Every point's end step values are completely overwritten, so we only need
+   // write access to them.
+   const double* props_data = matProps->HostRead();
+   const double* stress_beg = stress0->HostRead();
+   double* stress_end = stress1->HostWrite();
+   const double* statev_beg_data = matVars0->HostRead();
+   double* statev_end_data = matVars1->HostWrite();
+   double* ddsdde_data = matGrad->HostWrite();
+   const double* defgrad0 = defGrad0->HostRead();
+   const double* defgrad1 = end_def_grad.HostRead();
+   const double* incr_defgrad = incr_def_grad.HostRead();
 
    const int DIM4 = 4;
 
@@ -403,8 +409,74 @@ void AbaqusUmatModel::ModelSetup(const int nqpts, const int nelems, const int sp
    RAJA::Layout<DIM4> layout_jacob = RAJA::make_permuted_layout({{ space_dim, space_dim, nqpts, nelems } }, perm4);
    RAJA::View<const double, RAJA::Layout<DIM4, RAJA::Index_type, 0> > J(jacobian.HostRead(), layout_jacob);
 
-   for (int elemID = 0; elemID < nelems; elemID++) {
-      for (int ipID = 0; ipID < nqpts; ipID++) {
+#if defined(RAJA_ENABLE_OPENMP)
+   #pragma omp parallel if (reentrant)
+#endif
+   {
+      // Each thread has its own copy of the arrays passed to the UMAT
+      double props[nprops]; // populate from the mat props vector wrapped by matProps on the base class
+      double statev[nstatv]; // populate from the state variables associated with this element/ip
+
+      for (int i = 0; i < nprops; i++) {
+         props[i] = props_data[i];
+      }
+
+#if defined(RAJA_ENABLE_OPENMP)
+      #pragma omp for schedule(static)
+#endif
+      for (int ipts = 0; ipts < npts; ipts++) {
+         const int elemID = ipts / nqpts;
+         const int ipID = ipts % nqpts;
+
+         int noel = elemID; // element id
+         int npt = ipID; // integration point number
+         int layer = 0;
+         int kspt = 0;
+         int kstep = 0;
+         int kinc = 0;
+
+         double pnewdt = 10.0; // revisit this
+         double rpl = 0.0; // volumetric heat generation per unit time, not considered
+         double drpldt = 0.0; // variation of rpl wrt temperature set to 0.0
+         double tempk = 300.0; // no thermal considered at this point
+         double dtemp = 0.0; // no increment in thermal considered at this point
+         double predef = 0.0; // no interpolated values of predefined field variables at ip point
+         double dpred = 0.0; // no array of increments of predefined field variables
+         double sse = 0.0; // specific elastic strain energy, mainly for output
+         double spd = 0.0; // specific plastic dissipation, mainly for output
+         double scd = 0.0; // specific creep dissipation, mainly for output
+         double cmname = 0.0; // user defined UMAT name
+
+         // integration point coordinates
+         // a material model shouldn't need this ever
+         double coords[3] = { 0, 0, 0 };
+
+         // set the time step
+         double deltaTime = dt; // set on the ExaModel base class
+
+         // set time. Abaqus has odd increment definition. time[1] is the value of total
+         // time at the beginning of the current increment. Since we are iterating from
+         // tn to tn+1, this is just tn. time[0] is value of step time at the beginning
+         // of the current increment. What is step time if not tn? It seems as though
+         // they sub-increment between tn->tn+1, where there is a Newton Raphson loop
+         // advancing the sub-increment. For now, set time[0] is set to t - dt/
+         double time[2];
+
+         double stress[6]; // Cauchy stress at ip
+         double ddsdt[6]; // variation of the stress increments wrt to temperature, set to 0.0
+         double drplde[6]; // variation of rpl wrt strain increments, set to 0.0
+         double stran[6]; // array containing total strains at beginning of the increment
+         double dstran[6]; // array of strain increments
+
+         double drot[9]; // rotation matrix for finite deformations
+         double dfgrd0[9]; // deformation gradient at beginning of increment
+         double dfgrd1[9]; // defomration gradient at the end of the increment.
+                           // set to zero if nonlinear geometric effects are not
+                           // included in the step as is the case for ExaConstit
+         double ddsdde[36]; // output Jacobian matrix of the constitutive model.
+                            // ddsdde(i,j) defines the change in the ith stress component
+                            // due to an incremental perturbation in the jth strain increment
+
          // compute characteristic element length
          const double J11 = J(0, 0, ipID, elemID); // 0,0
          const double J21 = J(1, 0, ipID, elemID); // 1,0
@@ -418,125 +490,141 @@ void AbaqusUmatModel::ModelSetup(const int nqpts, const int nelems, const int sp
          const double detJ = J11 * (J22 * J33 - J32 * J23) -
                              /* */ J21 * (J12 * J33 - J32 * J13) +
                              /* */ J31 * (J12 * J23 - J22 * J13);
-         CalcElemLength(detJ);
-         celent = elemLength;
-
-         const int offset = elemID * nqpts * vdim + ipID * vdim;
-
-         noel = elemID; // element id
-         npt = ipID; // integration point number
-
-         // initialize 1d arrays
-         for (int i = 0; i<6; ++i) {
-            stress[i] = 0.0;
-            ddsdt[i] = 0.0;
-            drplde[i] = 0.0;
-            stran[i] = 0.0;
-            dstran[i] = 0.0;
-         }
-
-         // initialize 6x6 2d arrays
-         for (int i = 0; i<6; ++i) {
-            for (int j = 0; j<6; ++j) {
-               ddsdde[(i * 6) + j] = 0.0;
+         double celent = CalcElemLength(detJ);
+
+         // The deformation gradients are stored in column major order
+         const double* dgrad0 = &(defgrad0[ipts * vdim]);
+         const double* dgrad1 = &(defgrad1[ipts * vdim]);
+         const double* incr_dgrad = &(incr_defgrad[ipts * vdim]);
+
+         const double* stress_beg_pt = &(stress_beg[ipts * ntens]);
+         const double* statev_beg = &(statev_beg_data[ipts * nstatv]);
+
+         // The UMAT lets us know through pnewdt if the increment was too large for it.
+         // Rather than cutting back the time step for the entire mesh, just this point is
+         // re-integrated from the beginning of the time step over twice as many sub-increments
+         // until the UMAT is happy or we hit the max number of sub-increments. In the latter
+         // case, the last result is what's kept.
+         for (int nsub = 1; ; nsub *= 2) {
+            bool substep_fail = false;
+            pnewdt = 10.0;
+            deltaTime = dt / nsub;
+
+            for (int i = 0; i < nstatv; i++) {
+               statev[i] = statev_beg[i];
             }
-         }
-
 
-         incr_dgrad.UseExternalData((incr_defgrad + offset), 3, 3);
-         dgrad0.UseExternalData((defgrad0 + offset), 3, 3);
-         dgrad1.UseExternalData((defgrad1 + offset), 3, 3);
-
-         DenseMatrix Uincr(3), Vincr(3);
-         DenseMatrix Rincr(incr_dgrad, 3);
-         CalcPolarDecompDefGrad(Rincr, Uincr, Vincr);
-
-         drot = Rincr.GetData();
+            // ensure proper ordering of the stress array. ExaConstit uses
+            // Voigt notation (11, 22, 33, 23, 13, 12), while
+            // ------------------------------------------------------------------
+            // We use Voigt notation: (11, 22, 33, 23, 13, 12)
+            //
+            // ABAQUS USES:
+            // (11, 22, 33, 12, 13, 23)
+            // ------------------------------------------------------------------
+            stress[0] = stress_beg_pt[0];
+            stress[1] = stress_beg_pt[1];
+            stress[2] = stress_beg_pt[2];
+            stress[3] = stress_beg_pt[5];
+            stress[4] = stress_beg_pt[4];
+            stress[5] = stress_beg_pt[3];
+
+            for (int isub = 0; isub < nsub; isub++) {
+               // The deformation gradients at the beginning and end of this sub-increment
+               // are linearly interpolated from the beginning and end step values.
+               const double a0 = (double) isub / (double) nsub;
+               const double a1 = (double) (isub + 1) / (double) nsub;
+               // populate the beginning step and end step (or best guess to end step
+               // within the Newton iterations) of the deformation gradients
+               double fincr[9];
+               if (nsub == 1) {
+                  for (int i = 0; i < 9; i++) {
+                     dfgrd0[i] = dgrad0[i];
+                     dfgrd1[i] = dgrad1[i];
+                     fincr[i] = incr_dgrad[i];
+                  }
+               }
+               else {
+                  double fsub0_inv[9];
+                  for (int i = 0; i < 9; i++) {
+                     dfgrd0[i] = (1.0 - a0) * dgrad0[i] + a0 * dgrad1[i];
+                     dfgrd1[i] = (1.0 - a1) * dgrad0[i] + a1 * dgrad1[i];
+                  }
+                  Invert3x3(dfgrd0, fsub0_inv);
+                  Mult3x3(dfgrd1, fsub0_inv, fincr);
+               }
+
+               time[0] = t - dt + a0 * dt;
+               time[1] = t + a0 * dt;
+
+               CalcPolarRot3x3(fincr, drot);
+
+               // Abaqus does mention wanting to use a log strain for large strains
+               // It's also based on an updated lagrangian formulation so as long as
+               // we aren't generating any crazy strains do we really need to use the
+               // log strain?
+               double strain[9];
+               CalcEulerianStrain3x3(dfgrd1, strain);
+
+               // populate STRAN (symmetric)
+               // ------------------------------------------------------------------
+               // We use Voigt notation: (11, 22, 33, 23, 13, 12)
+               //
+               // ABAQUS USES:
+               // (11, 22, 33, 12, 13, 23)
+               // ------------------------------------------------------------------
+               stran[0] = strain[0];
+               stran[1] = strain[4];
+               stran[2] = strain[8];
+               stran[3] = 2 * strain[3];
+               stran[4] = 2 * strain[6];
+               stran[5] = 2 * strain[7];
+
+               // compute incremental strain, DSTRAN
+               CalcEulerianStrain3x3(fincr, strain);
+
+               // populate DSTRAN (symmetric)
+               // ------------------------------------------------------------------
+               // We use Voigt notation: (11, 22, 33, 23, 13, 12)
+               //
+               // ABAQUS USES:
+               // (11, 22, 33, 12, 13, 23)
+               // ------------------------------------------------------------------
+               dstran[0] = strain[0];
+               dstran[1] = strain[4];
+               dstran[2] = strain[8];
+               dstran[3] = 2 * strain[3];
+               dstran[4] = 2 * strain[6];
+               dstran[5] = 2 * strain[7];
+
+               for (int i = 0; i < 6; ++i) {
+                  ddsdt[i] = 0.0;
+                  drplde[i] = 0.0;
+               }
+
+               for (int i = 0; i < 36; ++i) {
+                  ddsdde[i] = 0.0;
+               }
+
+               // call c++ wrapper of umat routine
+               umat(&stress[0], &statev[0], &ddsdde[0], &sse, &spd, &scd, &rpl,
+                    ddsdt, drplde, &drpldt, &stran[0], &dstran[0], time,
+                    &deltaTime, &tempk, &dtemp, &predef, &dpred, &cmname,
+                    &ndi, &nshr, &ntens, &nstatv, &props[0], &nprops, &coords[0],
+                    drot, &pnewdt, &celent, &dfgrd0[0], &dfgrd1[0], &noel, &npt,
+                    &layer, &kspt, &kstep, &kinc);
+
+               if (pnewdt < 1.0) {
+                  substep_fail = true;
+                  break;
+               }
+            }
 
-         // populate the beginning step and end step (or best guess to end step
-         // within the Newton iterations) of the deformation gradients
-         for (int i = 0; i<ndi; ++i) {
-            for (int j = 0; j<ndi; ++j) {
-               // Dense matrices have column major layout so the below is fine.
-               dfgrd0[(i * 3) + j] = dgrad0(j, i);
-               dfgrd1[(i * 3) + j] = dgrad1(j, i);
+            if (!substep_fail || (2 * nsub > max_substeps)) {
+               break;
             }
          }
 
-         // get state variables and material properties
-         GetElementStateVars(elemID, ipID, true, statev, nstatv);
-         GetMatProps(props);
-
-         // get element stress and make sure ordering is ok
-         double stressTemp[6];
-         double stressTemp2[6];
-         GetElementStress(elemID, ipID, true, stressTemp, 6);
-
-         // ensure proper ordering of the stress array. ExaConstit uses
-         // Voigt notation (11, 22, 33, 23, 13, 12), while
-         // ------------------------------------------------------------------
-         // We use Voigt notation: (11, 22, 33, 23, 13, 12)
-         //
-         // ABAQUS USES:
-         // (11, 22, 33, 12, 13, 23)
-         // ------------------------------------------------------------------
-         stress[0] = stressTemp[0];
-         stress[1] = stressTemp[1];
-         stress[2] = stressTemp[2];
-         stress[3] = stressTemp[5];
-         stress[4] = stressTemp[4];
-         stress[5] = stressTemp[3];
-
-         // Abaqus does mention wanting to use a log strain for large strains
-         // It's also based on an updated lagrangian formulation so as long as
-         // we aren't generating any crazy strains do we really need to use the
-         // log strain?
-         DenseMatrix LogStrain;
-         LogStrain.SetSize(ndi); // ndi x ndi
-         CalcEulerianStrain(LogStrain, dgrad1);
-
-         // populate STRAN (symmetric)
-         // ------------------------------------------------------------------
-         // We use Voigt notation: (11, 22, 33, 23, 13, 12)
-         //
-         // ABAQUS USES:
-         // (11, 22, 33, 12, 13, 23)
-         // ------------------------------------------------------------------
-         stran[0] = LogStrain(0, 0);
-         stran[1] = LogStrain(1, 1);
-         stran[2] = LogStrain(2, 2);
-         stran[3] = 2 * LogStrain(0, 1);
-         stran[4] = 2 * LogStrain(0, 2);
-         stran[5] = 2 * LogStrain(1, 2);
-
-         // compute incremental strain, DSTRAN
-         DenseMatrix dLogStrain;
-         dLogStrain.SetSize(ndi);
-         CalcEulerianStrainIncr(dLogStrain, incr_dgrad);
-
-         // populate DSTRAN (symmetric)
-         // ------------------------------------------------------------------
-         // We use Voigt notation: (11, 22, 33, 23, 13, 12)
-         //
-         // ABAQUS USES:
-         // (11, 22, 33, 12, 13, 23)
-         // ------------------------------------------------------------------
-         dstran[0] = dLogStrain(0, 0);
-         dstran[1] = dLogStrain(1, 1);
-         dstran[2] = dLogStrain(2, 2);
-         dstran[3] = 2 * dLogStrain(0, 1);
-         dstran[4] = 2 * dLogStrain(0, 2);
-         dstran[5] = 2 * dLogStrain(1, 2);
-
-
-         // call c++ wrapper of umat routine
-         umat(&stress[0], &statev[0], &ddsdde[0], &sse, &spd, &scd, &rpl,
-              ddsdt, drplde, &drpldt, &stran[0], &dstran[0], time,
-              &deltaTime, &tempk, &dtemp, &predef, &dpred, &cmname,
-              &ndi, &nshr, &ntens, &nstatv, &props[0], &nprops, &coords[0],
-              drot, &pnewdt, &celent, &dfgrd0[0], &dfgrd1[0], &noel, &npt,
-              &layer, &kspt, &kstep, &kinc);
-
          // Due to how Abaqus has things ordered we need to swap the 4th and 6th columns
          // and rows with one another for our C_stiffness matrix.
          int j = 3;
@@ -550,7 +638,9 @@ void AbaqusUmatModel::ModelSetup(const int nqpts, const int nelems, const int sp
          }
 
          // set the material stiffness on the model
-         SetElementMatGrad(elemID, ipID, ddsdde, ntens * ntens);
+         for (int i = 0; i < ntens * ntens; i++) {
+            ddsdde_data[ipts * ntens * ntens + i] = ddsdde[i];
+         }
 
          // set the updated stress on the model. Have to convert from Abaqus
          // ordering to Voigt notation ordering
@@ -560,22 +650,128 @@ void AbaqusUmatModel::ModelSetup(const int nqpts, const int nelems, const int sp
          // ABAQUS USES:
          // (11, 22, 33, 12, 13, 23)
          // ------------------------------------------------------------------
-         stressTemp2[0] = stress[0];
-         stressTemp2[1] = stress[1];
-         stressTemp2[2] = stress[2];
-         stressTemp2[3] = stress[5];
-         stressTemp2[4] = stress[4];
-         stressTemp2[5] = stress[3];
-
-         SetElementStress(elemID, ipID, false, stressTemp2, ntens);
+         double* stress_end_pt = &(stress_end[ipts * ntens]);
+         stress_end_pt[0] = stress[0];
+         stress_end_pt[1] = stress[1];
+         stress_end_pt[2] = stress[2];
+         stress_end_pt[3] = stress[5];
+         stress_end_pt[4] = stress[4];
+         stress_end_pt[5] = stress[3];
 
          // set the updated statevars
-         SetElementStateVars(elemID, ipID, false, statev, nstatv);
+         for (int i = 0; i < nstatv; i++) {
+            statev_end_data[ipts * nstatv + i] = statev[i];
+         }
       }
    }
 }
 
-void AbaqusUmatModel::CalcElemLength(const double elemVol)
+// Runs the batched material interface over blocks of batch_size points at a time.
+// The inputs for a block are gathered into arrays where the point is the fastest
+// index, and the outputs are scattered back out afterwards. If the model is re-entrant,
+// the blocks are split up across the OpenMP threads.
+void AbaqusUmatModel::ModelSetupBatched(const int nqpts, const int nelems,
+                                        const Vector &jacobian)
+{
+   int nprops = numProps;
+   int nstatv = numStateVars;
+   const int ntens = 6;
+   const int npts = nqpts * nelems;
+   const int vdim = end_def_grad.GetVDim();
+   const int nblks = (npts + batch_size - 1) / batch_size;
+
+   // The UMAT interface doesn't take in const arrays so we need a copy of these
+   std::vector<double> props(matProps->HostRead(), matProps->HostRead() + nprops);
+   double* props_data = props.data();
+   const double* jacobian_data = jacobian.HostRead();
+   const double* stress_beg = stress0->HostRead();
+   double* stress_end = stress1->HostWrite();
+   const double* statev_beg_data = matVars0->HostRead();
+   double* statev_end_data = matVars1->HostWrite();
+   double* ddsdde_data = matGrad->HostWrite();
+   const double* defgrad0 = defGrad0->HostRead();
+   const double* defgrad1 = end_def_grad.HostRead();
+   const double* incr_defgrad = incr_def_grad.HostRead();
+
+   double time[2];
+   time[0] = t - dt;
+   time[1] = t;
+   double deltaTime = dt;
+
+#if defined(RAJA_ENABLE_OPENMP)
+   #pragma omp parallel if (reentrant)
+#endif
+   {
+      // Each thread has its own block sized work arrays
+      const int nb_max = batch_size;
+      std::vector<double> celent(nb_max), stran(ntens * nb_max), dstran(ntens * nb_max);
+      std::vector<double> drot(9 * nb_max), dfgrd0(9 * nb_max), dfgrd1(9 * nb_max);
+      std::vector<double> stress(ntens * nb_max), statev(nstatv * nb_max);
+      std::vector<double> ddsdde(ntens * ntens * nb_max);
+      double time_blk[2] = { time[0], time[1] };
+      double dt_blk = deltaTime;
+
+#if defined(RAJA_ENABLE_OPENMP)
+      #pragma omp for schedule(static)
+#endif
+      for (int iblk = 0; iblk < nblks; iblk++) {
+         const int ipts_beg = iblk * batch_size;
+         int nb = std::min(batch_size, npts - ipts_beg);
+
+         for (int ib = 0; ib < nb; ib++) {
+            const int ipts = ipts_beg + ib;
+            celent[ib] = CalcElemLength(Det3x3(&jacobian_data[ipts * 9]));
+
+            const double* dgrad0 = &(defgrad0[ipts * vdim]);
+            const double* dgrad1 = &(defgrad1[ipts * vdim]);
+            const double* incr_dgrad = &(incr_defgrad[ipts * vdim]);
+            double rot[9], strain[9], dstrain[9];
+            CalcPolarRot3x3(incr_dgrad, rot);
+            CalcEulerianStrain3x3(dgrad1, strain);
+            CalcEulerianStrain3x3(incr_dgrad, dstrain);
+            for (int i = 0; i < 9; i++) {
+               drot[ib + nb * i] = rot[i];
+               dfgrd0[ib + nb * i] = dgrad0[i];
+               dfgrd1[ib + nb * i] = dgrad1[i];
+            }
+            // Voigt notation: (11, 22, 33, 23, 13, 12) with engineering shear strains
+            const int vi[6] = { 0, 4, 8, 7, 6, 3 };
+            const double fac[6] = { 1.0, 1.0, 1.0, 2.0, 2.0, 2.0 };
+            for (int i = 0; i < ntens; i++) {
+               stran[ib + nb * i] = fac[i] * strain[vi[i]];
+               dstran[ib + nb * i] = fac[i] * dstrain[vi[i]];
+               stress[ib + nb * i] = stress_beg[ipts * ntens + i];
+            }
+            for (int i = 0; i < nstatv; i++) {
+               statev[ib + nb * i] = statev_beg_data[ipts * nstatv + i];
+            }
+            for (int i = 0; i < ntens * ntens; i++) {
+               ddsdde[ib + nb * i] = 0.0;
+            }
+         }
+
+         umat_batch(&nb, &nstatv, &nprops, props_data, &dt_blk, time_blk,
+                    celent.data(), stran.data(), dstran.data(), drot.data(),
+                    dfgrd0.data(), dfgrd1.data(), stress.data(), statev.data(),
+                    ddsdde.data());
+
+         for (int ib = 0; ib < nb; ib++) {
+            const int ipts = ipts_beg + ib;
+            for (int i = 0; i < ntens; i++) {
+               stress_end[ipts * ntens + i] = stress[ib + nb * i];
+            }
+            for (int i = 0; i < nstatv; i++) {
+               statev_end_data[ipts * nstatv + i] = statev[ib + nb * i];
+            }
+            for (int i = 0; i < ntens * ntens; i++) {
+               ddsdde_data[ipts * ntens * ntens + i] = ddsdde[ib + nb * i];
+            }
+         }
+      }
+   }
+}
+
+double AbaqusUmatModel::CalcElemLength(const double elemVol) const
 {
    // It can also be approximated as the cube root of the element's volume.
    // I think this one might be a little nicer to use because for distorted elements
@@ -585,7 +781,5 @@ void AbaqusUmatModel::CalcElemLength(const double elemVol)
    // although this does change from integration to integration point
    // since we're using the determinate instead of the actual volume. However,
    // it should be good enough for our needs...
-   elemLength = cbrt(elemVol);
-
-   return;
+   return cbrt(elemVol);
 }
@@ -11,11 +11,11 @@ class AbaqusUmatModel : public ExaModel
 {
    protected:
 
-      // add member variables.
-      double elemLength;
-
-      // The initial local shape function gradients.
-      mfem::QuadratureFunction loc0_sf_grad;
+      // The Jacobians of the reference configuration at each quadrature point.
+      mfem::Vector ref_jacobian;
+      // The element restriction operator and the E-vector of the end coordinates
+      const mfem::Operator* elem_restrict;
+      mfem::Vector el_x;
 
       // The incremental deformation gradients.
       mfem::QuadratureFunction incr_def_grad;
@@ -27,6 +27,18 @@ class AbaqusUmatModel : public ExaModel
       // The beggining time step deformation gradient
       mfem::QuadratureFunction *defGrad0;
 
+      // The max number of sub-increments a point's time step can be split into
+      // if the UMAT requests a smaller time increment through pnewdt.
+      int max_substeps;
+
+      // Whether the UMAT is re-entrant (no shared or saved state), so the points
+      // can be run in parallel over the OpenMP threads.
+      bool reentrant;
+
+      // If greater than 0, the batched material interface (umat_batch) is used
+      // and is called on blocks of this many points at a time.
+      int batch_size;
+
       // pointer to umat function
       // we really don't use this in the code
       void (*umatp)(double[6], double[], double[36],
@@ -47,28 +59,34 @@ class AbaqusUmatModel : public ExaModel
       void CalcLagrangianStrainIncr(mfem::DenseMatrix& dE, const mfem::DenseMatrix &Jpt);
 
       // calculates the element length
-      void CalcElemLength(const double elemVol);
+      double CalcElemLength(const double elemVol) const;
 
       void init_loc_sf_grads(mfem::ParFiniteElementSpace *fes);
       void init_incr_end_def_grad();
 
-      // For when the ParFinitieElementSpace is stored on the class...
-      virtual void calc_incr_end_def_grad(const mfem::Vector &x0);
+      // Calculates the end step and incremental deformation gradients from the
+      // end coordinates using the provided local shape function gradients
+      virtual void calc_incr_end_def_grad(const mfem::Vector &loc_grad);
       virtual void calcDpMat(mfem::QuadratureFunction &/* DpMat */) const {};
 
+      // Runs the batched material interface rather than the per point UMAT
+      void ModelSetupBatched(const int nqpts, const int nelems, const mfem::Vector &jacobian);
+
    public:
       AbaqusUmatModel(mfem::QuadratureFunction *_q_stress0, mfem::QuadratureFunction *_q_stress1,
                       mfem::QuadratureFunction *_q_matGrad, mfem::QuadratureFunction *_q_matVars0,
                       mfem::QuadratureFunction *_q_matVars1, mfem::QuadratureFunction *_q_defGrad0,
                       mfem::ParGridFunction* _beg_coords, mfem::ParGridFunction* _end_coords,
                       mfem::Vector *_props, int _nProps,
-                      int _nStateVars, mfem::ParFiniteElementSpace* fes, bool _PA) :
+                      int _nStateVars, mfem::ParFiniteElementSpace* fes, bool _PA,
+                      int _max_substeps = 1, bool _reentrant = false, int _batch_size = 0) :
          ExaModel(_q_stress0,
                   _q_stress1, _q_matGrad, _q_matVars0,
                   _q_matVars1,
                   _beg_coords, _end_coords,
                   _props, _nProps, _nStateVars, _PA), loc_fes(fes),
-         defGrad0(_q_defGrad0)
+         defGrad0(_q_defGrad0), max_substeps(_max_substeps), reentrant(_reentrant),
+         batch_size(_batch_size)
       {
          init_loc_sf_grads(fes);
          init_incr_end_def_grad();
@@ -80,7 +98,7 @@ class AbaqusUmatModel : public ExaModel
 
       virtual void ModelSetup(const int nqpts, const int nelems, const int space_dim,
                               const int /*nnodes*/, const mfem::Vector &jacobian,
-                              const mfem::Vector & /*loc_grad*/, const mfem::Vector &vel);
+                              const mfem::Vector &loc_grad, const mfem::Vector & /*vel*/);
 };
 
 #endif
@@ -8,6 +8,7 @@
 #include "ECMech_const.h"
 #include <iostream>
 #include <fstream>
+#include <algorithm>
 
 
 inline bool if_file_exists (const std::string& name) {
@@ -273,6 +274,22 @@ void ExaOptions::get_model()
 
    cp = toml->get_qualified_as<bool>("Model.cp").value_or(false);
 
+   max_substeps = toml->get_qualified_as<int>("Model.max_substeps").value_or(1);
+   if (max_substeps < 1) {
+      MFEM_ABORT("Model.max_substeps needs to be greater than or equal to 1.");
+   }
+
+   if (mech_type == MechType::UMAT) {
+      umat_reentrant = toml->get_qualified_as<bool>("Model.UMAT.reentrant").value_or(false);
+      umat_batch_size = toml->get_qualified_as<int>("Model.UMAT.batch_size").value_or(0);
+      if (umat_batch_size < 0) {
+         MFEM_ABORT("Model.UMAT.batch_size needs to be greater than or equal to 0.");
+      }
+      if ((umat_batch_size > 0) && (max_substeps > 1)) {
+         MFEM_ABORT("Model.max_substeps can't be used with the batched UMAT interface (Model.UMAT.batch_size > 0).");
+      }
+   }
+
    if (mech_type == MechType::EXACMECH) {
       if (!cp) {
          MFEM_ABORT("Model.cp needs to be set to true when using ExaCMech based models.");
@@ -289,6 +306,21 @@ void ExaOptions::get_model()
 
       std::string _xtal_type = exacmech_table->get_as<std::string>("xtal_type").value_or("");
       std::string _slip_type = exacmech_table->get_as<std::string>("slip_type").value_or("");
+      chunk_size = exacmech_table->get_as<int>("chunk_size").value_or(0);
+      if (chunk_size < 0) {
+         MFEM_ABORT("Model.ExaCMech.chunk_size needs to be greater than or equal to 0.");
+      }
+      dyn_sched = exacmech_table->get_as<bool>("dynamic_schedule").value_or(false);
+      cost_sort = exacmech_table->get_as<bool>("cost_sort").value_or(false);
+      soa_state_vars = exacmech_table->get_as<bool>("soa_state_vars").value_or(false);
+      screen_frac = exacmech_table->get_as<double>("elastic_screen").value_or(0.0);
+      if ((screen_frac < 0.0) || (screen_frac >= 1.0)) {
+         MFEM_ABORT("Model.ExaCMech.elastic_screen needs to be greater than or equal to 0 and less than 1.");
+      }
+      substep_evals = exacmech_table->get_as<int>("substep_evals").value_or(0);
+      if (substep_evals < 0) {
+         MFEM_ABORT("Model.ExaCMech.substep_evals needs to be greater than or equal to 0.");
+      }
 
       if ((_xtal_type == "fcc") || (_xtal_type == "FCC")) {
          xtal_type = XtalType::FCC;
@@ -385,6 +417,11 @@ void ExaOptions::get_model()
          MFEM_ABORT("Model.ExaCMech.slip_type was not provided a valid type.");
          slip_type = SlipType::NOTYPE;
       }
+
+      // The MTSDD hardness is a dislocation density rather than a slip resistance
+      if ((screen_frac > 0.0) && (slip_type == SlipType::MTSDD)) {
+         MFEM_ABORT("Model.ExaCMech.elastic_screen can only be used with the PowerVoce and PowerVoceNL slip types.");
+      }
    }
 } // end of model parsing
 
@@ -432,6 +469,49 @@ void ExaOptions::get_visualizations()
    }
    std::string _basename = toml->get_qualified_as<std::string>("Visualizations.floc").value_or("results/exaconstit");
    basename = _basename;
+
+   {
+      const std::vector<std::string> base_fields = {"Displacement", "Velocity", "Stress",
+                                                    "VonMisesStress", "HydrostaticStress"};
+      const std::vector<std::string> ecmech_fields = {"DpEff", "EffPlasticStrain", "LatticeOrientation",
+                                                      "ShearRate", "ShearRateSum", "Hardness"};
+      auto _vis_fields = toml->get_qualified_array_of<std::string>("Visualizations.fields");
+      if (_vis_fields) {
+         vis_fields = *_vis_fields;
+         for (auto &name : vis_fields) {
+            const bool is_base = std::find(base_fields.begin(), base_fields.end(), name) != base_fields.end();
+            const bool is_ecmech = std::find(ecmech_fields.begin(), ecmech_fields.end(), name) != ecmech_fields.end();
+            if (!is_base && !is_ecmech) {
+               MFEM_ABORT("Visualizations.fields contains an unknown field: " << name);
+            }
+            if (is_ecmech && mech_type != MechType::EXACMECH) {
+               MFEM_ABORT("Visualizations.fields: " << name << " is only available with the ExaCMech models");
+            }
+         }
+      }
+      else {
+         vis_fields = base_fields;
+         if (mech_type == MechType::EXACMECH) {
+            for (auto &name : ecmech_fields) {
+               if (name != "ShearRateSum") {
+                  vis_fields.push_back(name);
+               }
+            }
+         }
+      }
+   }
+
+   auto _shear_rate_systems = toml->get_qualified_array_of<int64_t>("Visualizations.shear_rate_systems");
+   if (_shear_rate_systems) {
+      const int nslip = (xtal_type == XtalType::HCP) ? 24 : 12;
+      for (auto isys : *_shear_rate_systems) {
+         if (isys < 0 || isys >= nslip) {
+            MFEM_ABORT("Visualizations.shear_rate_systems must be in the range [0, " << nslip << ")");
+         }
+         shear_rate_systems.push_back(static_cast<int>(isys));
+      }
+   }
+
    std::string _avg_stress_fname = toml->get_qualified_as<std::string>("Visualizations.avg_stress_fname").value_or("avg_stress.txt");
    avg_stress_fname = _avg_stress_fname;
    bool _additional_avgs = toml->get_qualified_as<bool>("Visualizations.additional_avgs").value_or(false);
@@ -442,6 +522,104 @@ void ExaOptions::get_visualizations()
    avg_pl_work_fname = _avg_pl_work_fname;
    std::string _avg_dp_tensor_fname = toml->get_qualified_as<std::string>("Visualizations.avg_dp_tensor_fname").value_or("avg_dp_tensor.txt");
    avg_dp_tensor_fname = _avg_dp_tensor_fname;
+   raw_qpts = toml->get_qualified_as<bool>("Visualizations.raw_qpts").value_or(false);
+   auto _raw_qpt_fields = toml->get_qualified_array_of<std::string>("Visualizations.raw_qpt_fields");
+   if (_raw_qpt_fields) {
+      raw_qpt_fields = *_raw_qpt_fields;
+   }
+   if (raw_qpts && raw_qpt_fields.size() == 0) {
+      MFEM_ABORT("Visualizations.raw_qpt_fields needs at least one field when raw_qpts is true");
+   }
+   grain_stats = toml->get_qualified_as<bool>("Visualizations.grain_stats").value_or(false);
+   grain_stats_moments = toml->get_qualified_as<bool>("Visualizations.grain_stats_moments").value_or(false);
+   auto _grain_stats_fields = toml->get_qualified_array_of<std::string>("Visualizations.grain_stats_fields");
+   if (_grain_stats_fields) {
+      grain_stats_fields = *_grain_stats_fields;
+   }
+   if (grain_stats && grain_stats_fields.size() == 0) {
+      MFEM_ABORT("Visualizations.grain_stats_fields needs at least one field when grain_stats is true");
+   }
+   std::string _grain_stats_fname = toml->get_qualified_as<std::string>("Visualizations.grain_stats_fname").value_or("grain_stats.txt");
+   grain_stats_fname = _grain_stats_fname;
+
+   auto lattice_table = toml->get_table_qualified("Visualizations.LatticeStrains");
+   if (lattice_table != nullptr) {
+      lattice_strains = true;
+      if (mech_type != MechType::EXACMECH) {
+         MFEM_ABORT("Visualizations.LatticeStrains is only available with the ExaCMech models");
+      }
+      if (xtal_type == XtalType::HCP) {
+         MFEM_ABORT("Visualizations.LatticeStrains currently only supports cubic crystals");
+      }
+      auto hkls = lattice_table->get_array_of<cpptoml::array>("hkl");
+      if (hkls) {
+         for (const auto &vec : *hkls) {
+            auto vals = (*vec).get_array_of<int64_t>();
+            if (!vals || vals->size() != 3) {
+               MFEM_ABORT("Visualizations.LatticeStrains.hkl must be made up of arrays of 3 integers");
+            }
+            lattice_hkls.push_back(std::vector<int>(vals->begin(), vals->end()));
+         }
+      }
+      auto dirs = lattice_table->get_array_of<cpptoml::array>("directions");
+      if (dirs) {
+         for (const auto &vec : *dirs) {
+            auto vals = (*vec).get_array_of<double>();
+            if (!vals || vals->size() != 3) {
+               MFEM_ABORT("Visualizations.LatticeStrains.directions must be made up of arrays of 3 floats");
+            }
+            lattice_dirs.push_back(*vals);
+         }
+      }
+      if (lattice_hkls.empty() || lattice_dirs.empty()) {
+         MFEM_ABORT("Visualizations.LatticeStrains needs at least one hkl and one direction");
+      }
+      lattice_tol = lattice_table->get_as<double>("tolerance").value_or(5.0);
+      if (lattice_tol <= 0.0 || lattice_tol > 90.0) {
+         MFEM_ABORT("Visualizations.LatticeStrains.tolerance must be in (0, 90] degrees");
+      }
+      std::string _lattice_fname = lattice_table->get_as<std::string>("fname").value_or("lattice_strains.txt");
+      lattice_fname = _lattice_fname;
+   }
+
+   auto hist_table = toml->get_table_qualified("Visualizations.Histograms");
+   if (hist_table != nullptr) {
+      histograms = true;
+      auto _hist_fields = hist_table->get_array_of<std::string>("fields");
+      if (_hist_fields) {
+         hist_fields = *_hist_fields;
+      }
+      auto ranges = hist_table->get_array_of<cpptoml::array>("ranges");
+      if (ranges) {
+         for (const auto &vec : *ranges) {
+            auto vals = (*vec).get_array_of<double>();
+            if (!vals || vals->size() != 2 || (*vals)[1] <= (*vals)[0]) {
+               MFEM_ABORT("Visualizations.Histograms.ranges must be made up of [min, max] float arrays with max > min");
+            }
+            hist_ranges.push_back(*vals);
+         }
+      }
+      if (hist_fields.size() != hist_ranges.size()) {
+         MFEM_ABORT("Visualizations.Histograms.ranges must have a range for each of the fields");
+      }
+      hist_nbins = hist_table->get_as<int>("nbins").value_or(50);
+      std::string _hist_fname = hist_table->get_as<std::string>("fname").value_or("histograms.txt");
+      hist_fname = _hist_fname;
+      texture = hist_table->get_as<bool>("texture").value_or(false);
+      texture_sym = hist_table->get_as<bool>("texture_sym_reduce").value_or(true);
+      texture_nbins = hist_table->get_as<int>("texture_nbins").value_or(16);
+      std::string _texture_fname = hist_table->get_as<std::string>("texture_fname").value_or("texture.txt");
+      texture_fname = _texture_fname;
+      if (hist_nbins < 1 || texture_nbins < 1) {
+         MFEM_ABORT("Visualizations.Histograms.nbins and texture_nbins must be at least 1");
+      }
+      if (texture && mech_type != MechType::EXACMECH) {
+         MFEM_ABORT("Visualizations.Histograms.texture is only available with the ExaCMech models");
+      }
+      if (hist_fields.empty() && !texture) {
+         MFEM_ABORT("Visualizations.Histograms needs at least one field or the texture turned on");
+      }
+   }
 } // end of visualization parsing
 
 // From the toml file it finds all the values related to the Solvers
@@ -484,6 +662,14 @@ void ExaOptions::get_solvers()
       rtmodel = RTModel::NOTYPE;
    }
 
+   if ((screen_frac > 0.0) && (rtmodel == RTModel::CUDA)) {
+      MFEM_ABORT("Model.ExaCMech.elastic_screen can't be used if Solvers.rtmodel is CUDA.");
+   }
+
+   if ((substep_evals > 0) && (rtmodel == RTModel::CUDA)) {
+      MFEM_ABORT("Model.ExaCMech.substep_evals can't be used if Solvers.rtmodel is CUDA.");
+   }
+
    // Obtaining information related to the newton raphson solver
    auto nr_table = toml->get_table_qualified("Solvers.NR");
    if (nr_table != nullptr) {
@@ -545,6 +731,8 @@ void ExaOptions::get_mesh()
    ser_ref_levels = toml->get_qualified_as<int>("Mesh.ref_ser").value_or(0);
    par_ref_levels = toml->get_qualified_as<int>("Mesh.ref_par").value_or(0);
    order = toml->get_qualified_as<int>("Mesh.p_refinement").value_or(1);
+   // Whether or not we group all of the elements in a grain together
+   grain_sort = toml->get_qualified_as<bool>("Mesh.grain_sort").value_or(false);
    // file location of the mesh
    std::string _mesh_file = toml->get_qualified_as<std::string>("Mesh.floc").value_or("../../data/cube-hex-ro.mesh");
    mesh_file = _mesh_file;
@@ -625,6 +813,7 @@ void ExaOptions::print_options()
    std::cout << "P-refinement level: " << order << "\n";
 
    std::cout << std::boolalpha;
+   std::cout << "Elements sorted by grain: " << grain_sort << "\n";
    std::cout << "Custom dt flag (dt_cust): " << dt_cust << "\n";
 
    if (dt_cust) {
@@ -643,6 +832,18 @@ void ExaOptions::print_options()
    std::cout << "ADIOS2 flag: " << adios2 << "\n";
    std::cout << "Visualization steps: " << vis_steps << "\n";
    std::cout << "Visualization directory: " << basename << "\n";
+   std::cout << "Visualization fields:";
+   for (auto &name : vis_fields) {
+      std::cout << " " << name;
+   }
+   std::cout << std::endl;
+   if (!shear_rate_systems.empty()) {
+      std::cout << "Shear rate slip systems:";
+      for (auto isys : shear_rate_systems) {
+         std::cout << " " << isys;
+      }
+      std::cout << std::endl;
+   }
 
    std::cout << "Average stress filename: " << avg_stress_fname << std::endl;
    if (additional_avgs)
@@ -657,6 +858,49 @@ void ExaOptions::print_options()
       std::cout << "No additional averages being computed" << std::endl;
    }
    std::cout << "Average stress filename: " << avg_stress_fname << std::endl;
+   if (raw_qpts) {
+      std::cout << "Raw quadrature point fields being saved:";
+      for (auto &name : raw_qpt_fields) {
+         std::cout << " " << name;
+      }
+      std::cout << std::endl;
+   }
+   if (grain_stats) {
+      std::cout << "Per grain statistics filename: " << grain_stats_fname << std::endl;
+      std::cout << "Per grain statistics fields:";
+      for (auto &name : grain_stats_fields) {
+         std::cout << " " << name;
+      }
+      std::cout << std::endl;
+      std::cout << "Per grain second moments: " << grain_stats_moments << std::endl;
+   }
+   if (lattice_strains) {
+      std::cout << "Lattice strain filename: " << lattice_fname << std::endl;
+      std::cout << "Lattice strain hkl families:";
+      for (auto &hkl : lattice_hkls) {
+         std::cout << " (" << hkl[0] << " " << hkl[1] << " " << hkl[2] << ")";
+      }
+      std::cout << std::endl;
+      std::cout << "Lattice strain directions:";
+      for (auto &dir : lattice_dirs) {
+         std::cout << " [" << dir[0] << " " << dir[1] << " " << dir[2] << "]";
+      }
+      std::cout << std::endl;
+      std::cout << "Lattice strain tolerance (degrees): " << lattice_tol << std::endl;
+   }
+   if (histograms) {
+      std::cout << "Histogram filename: " << hist_fname << std::endl;
+      std::cout << "Histogram number of bins: " << hist_nbins << std::endl;
+      for (size_t i = 0; i < hist_fields.size(); i++) {
+         std::cout << "Histogram field: " << hist_fields[i] << " range: ["
+                   << hist_ranges[i][0] << ", " << hist_ranges[i][1] << "]" << std::endl;
+      }
+      if (texture) {
+         std::cout << "Texture filename: " << texture_fname << std::endl;
+         std::cout << "Texture number of bins per axis: " << texture_nbins << std::endl;
+         std::cout << "Texture symmetry reduced: " << texture_sym << std::endl;
+      }
+   }
 
    if (nl_solver == NLSolver::NR) {
       std::cout << "Nonlinear Solver is Newton Raphson \n";
@@ -719,6 +963,8 @@ void ExaOptions::print_options()
 
    if (mech_type == MechType::UMAT) {
       std::cout << "UMAT\n";
+      std::cout << "UMAT points run in parallel: " << umat_reentrant << "\n";
+      std::cout << "Batched UMAT interface block size: " << umat_batch_size << "\n";
    }
    else if (mech_type == MechType::EXACMECH) {
       std::cout << "ExaCMech\n";
@@ -744,8 +990,26 @@ void ExaOptions::print_options()
       else if (slip_type == SlipType::POWERVOCENL) {
          std::cout << "Power law slip kinetics with a nonlinear Voce hardening law\n";
       }
+
+      std::cout << "Number of quadrature points per material model block: ";
+      if (chunk_size > 0) {
+         std::cout << chunk_size << "\n";
+      }
+      else {
+         std::cout << "all\n";
+      }
+
+      std::cout << "Dynamic scheduling of material model blocks: " << dyn_sched << "\n";
+      if (dyn_sched) {
+         std::cout << "Blocks sorted by previous step cost: " << cost_sort << "\n";
+      }
+      std::cout << "State variables stored as a structure of arrays: " << soa_state_vars << "\n";
+      std::cout << "Elastic screening fraction of the slip resistance: " << screen_frac << "\n";
+      std::cout << "Solver evaluations that trigger sub-stepping of a point: " << substep_evals << "\n";
    }
 
+   std::cout << "Max number of sub-increments for a material point: " << max_substeps << "\n";
+
    std::cout << "Xtal Plasticity being used: " << cp << "\n";
 
    std::cout << "Orientation file location: " << ori_file << "\n";
@@ -27,6 +27,10 @@ class ExaOptions {
       // polynomial interpolation order
       int order;
 
+      // whether the mesh elements are reordered so that elements within the same
+      // grain (element attribute) are contiguous
+      bool grain_sort;
+
       // final simulation time and time step (set each to 1.0 for
       // single step debug)
       double t_final;
@@ -49,12 +53,47 @@ class ExaOptions {
       bool adios2;
       // Where to store the end time step files
       std::string basename;
+      // The element averaged fields that are projected and saved off with the above
+      // data collections, and the slip systems saved off in the ShearRate field
+      // (an empty list means all of them)
+      std::vector<std::string> vis_fields;
+      std::vector<int> shear_rate_systems;
       // average stress file name
       std::string avg_stress_fname;
       std::string avg_pl_work_fname;
       std::string avg_dp_tensor_fname;
       std::string avg_def_grad_fname;
       bool additional_avgs;
+      // Whether the raw quadrature point data of the below fields is written out
+      // in a binary format by each rank on the visualization steps
+      bool raw_qpts;
+      std::vector<std::string> raw_qpt_fields;
+      // Whether the per grain (element attribute) volume averages of the below fields
+      // are computed on the visualization steps, and whether their second moments are as well
+      bool grain_stats;
+      bool grain_stats_moments;
+      std::vector<std::string> grain_stats_fields;
+      std::string grain_stats_fname;
+      // In-situ lattice strain options. The hkl families are given in the crystal frame,
+      // and the directions (scattering vectors) are given in the sample frame. The tolerance
+      // is the max angle in degrees between a plane normal and a direction.
+      bool lattice_strains;
+      std::vector<std::vector<int> > lattice_hkls;
+      std::vector<std::vector<double> > lattice_dirs;
+      double lattice_tol;
+      std::string lattice_fname;
+      // In-situ histogram options. Each field has its own [min, max] range which is split
+      // up into hist_nbins bins. The texture is a histogram of the orientations in
+      // Rodrigues space which is optionally reduced to the fundamental region.
+      bool histograms;
+      std::vector<std::string> hist_fields;
+      std::vector<std::vector<double> > hist_ranges;
+      int hist_nbins;
+      std::string hist_fname;
+      bool texture;
+      bool texture_sym;
+      int texture_nbins;
+      std::string texture_fname;
 
       // newton input args
       double newton_rel_tol;
@@ -84,8 +123,30 @@ class ExaOptions {
       SlipType slip_type;
       // Specify the xtal type we'll be using - used if ExaCMech is being used
       XtalType xtal_type;
+      // Whether the UMAT is re-entrant, so the points can be run over the OpenMP threads
+      bool umat_reentrant;
+      // Number of points the batched UMAT interface is called on at a time.
+      // A value of 0 means the per point UMAT interface is used.
+      int umat_batch_size;
       // Specify the temperature of the material
       double temp_k;
+      // Number of quadrature points the ExaCMech models are run over at a time
+      // A value of 0 means all of the points are run at once
+      int chunk_size;
+      // Whether the ExaCMech blocks of points are dynamically scheduled over the
+      // OpenMP threads, and whether they're sorted by their previous step's cost
+      bool dyn_sched;
+      bool cost_sort;
+      // Whether the ExaCMech state variables are stored in a structure of arrays format
+      bool soa_state_vars;
+      // Points whose resolved shear stresses are below this fraction of their
+      // slip resistance are updated elastically without calling ExaCMech.
+      // A value of 0 turns this off.
+      double screen_frac;
+      // The max number of sub-increments a material point's time step can be split into
+      // and the number of ExaCMech solver evaluations that triggers the sub-stepping of a point.
+      int max_substeps;
+      int substep_evals;
 
 
       // grain input arguments
@@ -148,8 +209,18 @@ class ExaOptions {
          slip_type = SlipType::NOTYPE;
          // Specify the xtal type we'll be using - used if ExaCMech is being used
          xtal_type = XtalType::NOTYPE;
+         umat_reentrant = false;
+         umat_batch_size = 0;
          // Specify the temperature of the material
          temp_k = 298.;
+         // Run all of the ExaCMech quadrature points at once
+         chunk_size = 0;
+         dyn_sched = false;
+         cost_sort = false;
+         soa_state_vars = false;
+         screen_frac = 0.0;
+         max_substeps = 1;
+         substep_evals = 0;
 
          // Krylov Solver related variables
          // We set the default solver as GMRES in case we accidentally end up dealing
@@ -182,6 +253,22 @@ class ExaOptions {
          avg_def_grad_fname = "avg_def_grad.txt";
          avg_dp_tensor_fname = "avg_dp_tensor.txt";
          additional_avgs = false;
+         raw_qpts = false;
+         raw_qpt_fields = {"stress"};
+         grain_stats = false;
+         grain_stats_moments = false;
+         grain_stats_fields = {"stress"};
+         grain_stats_fname = "grain_stats.txt";
+         lattice_strains = false;
+         lattice_tol = 5.0;
+         lattice_fname = "lattice_strains.txt";
+         histograms = false;
+         hist_nbins = 50;
+         hist_fname = "histograms.txt";
+         texture = false;
+         texture_sym = true;
+         texture_nbins = 16;
+         texture_fname = "texture.txt";
 
          // Time step related parameters
          t_final = 1.0;
@@ -196,6 +283,7 @@ class ExaOptions {
          order = 1;
          mesh_file = "../../data/cube-hex-ro.mesh";
          mesh_type = MeshType::OTHER;
+         grain_sort = false;
 
          mxyz[0] = 1.0;
          mxyz[1] = 1.0;
@@ -4,11 +4,34 @@
 #include "system_driver.hpp"
 #include "RAJA/RAJA.hpp"
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <cstdint>
+#include <sys/stat.h>
 #include "mechanics_kernels.hpp"
+#include "mechanics_ecmech.hpp"
+#include <array>
 
 using namespace std;
 using namespace mfem;
 
+namespace {
+// Creates the directory along with any of its missing parent directories
+void MakeDirs(const std::string &dir)
+{
+   size_t pos = 0;
+   do {
+      pos = dir.find('/', pos + 1);
+      const std::string sub_dir = dir.substr(0, pos);
+      if (!sub_dir.empty()) {
+         mkdir(sub_dir.c_str(), 0775);
+      }
+   } while (pos != std::string::npos);
+}
+}
+
 
 SystemDriver::SystemDriver(ParFiniteElementSpace &fes,
                            Array<int> &ess_bdr,
@@ -46,6 +69,13 @@ SystemDriver::SystemDriver(ParFiniteElementSpace &fes,
    avg_def_grad_fname = options.avg_def_grad_fname;
    avg_dp_tensor_fname = options.avg_dp_tensor_fname;
    additional_avgs = options.additional_avgs;
+   vol_sums_pending = false;
+
+   dp_mat = nullptr;
+   if (mech_type == MechType::EXACMECH && additional_avgs) {
+      dp_mat = new QuadratureFunction(def_grad.GetSpace(), def_grad.GetVDim());
+      dp_mat->UseDevice(true);
+   }
 
    // Partial assembly we need to use a matrix free option instead for our preconditioner
    // Everything else remains the same.
@@ -145,12 +175,149 @@ SystemDriver::SystemDriver(ParFiniteElementSpace &fes,
    newton_solver->SetRelTol(options.newton_rel_tol);
    newton_solver->SetAbsTol(options.newton_abs_tol);
    newton_solver->SetMaxIter(options.newton_iter);
-   if (options.visit || options.conduit || options.paraview || options.adios2) {
-      postprocessing = true;
-      CalcElementAvg(evec, model->GetMatVars0());
-   } else {
-      postprocessing = false;
+   shear_rate_systems.SetSize(options.shear_rate_systems.size());
+   for (int i = 0; i < shear_rate_systems.Size(); i++) {
+      shear_rate_systems[i] = options.shear_rate_systems[i];
+   }
+   raw_qpts = options.raw_qpts;
+   raw_qpt_fields = options.raw_qpt_fields;
+   raw_qpt_dir = options.basename + "_qpts";
+   raw_qpt_elem_offset = 0;
+   if (raw_qpts) {
+      // Make sure all of the requested fields exist before we start running anything
+      for (auto &name : raw_qpt_fields) {
+         if (!HasQptField(name)) {
+            MFEM_ABORT("Visualizations.raw_qpt_fields has a field, " << name << ", that isn't available");
+         }
+      }
+      long long nelems = fe_space.GetNE();
+      MPI_Exscan(&nelems, &raw_qpt_elem_offset, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+      if (myid == 0) {
+         raw_qpt_elem_offset = 0;
+         MakeDirs(raw_qpt_dir);
+      }
+      MPI_Barrier(MPI_COMM_WORLD);
+   }
+
+   grain_stats = options.grain_stats;
+   grain_stats_moments = options.grain_stats_moments;
+   grain_stats_fields = options.grain_stats_fields;
+   grain_stats_fname = options.grain_stats_fname;
+   // The element attributes are the grain ids
+   grain_stats_ngrains = fes.GetMesh()->attributes.Max();
+   if (grain_stats) {
+      for (auto &name : grain_stats_fields) {
+         if (!HasQptField(name)) {
+            MFEM_ABORT("Visualizations.grain_stats_fields has a field, " << name << ", that isn't available");
+         }
+      }
    }
+
+   lattice_strains = options.lattice_strains;
+   lattice_fname = options.lattice_fname;
+   lattice_cos_tol = cos(options.lattice_tol * M_PI / 180.0);
+   if (lattice_strains) {
+      lattice_hkls = options.lattice_hkls;
+      lattice_dirs = options.lattice_dirs;
+
+      std::vector<double> normals;
+      lattice_fam_offsets.SetSize(lattice_hkls.size() + 1);
+      lattice_fam_offsets[0] = 0;
+      for (size_t f = 0; f < lattice_hkls.size(); f++) {
+         if (lattice_hkls[f][0] == 0 && lattice_hkls[f][1] == 0 && lattice_hkls[f][2] == 0) {
+            MFEM_ABORT("Visualizations.LatticeStrains.hkl can't contain (0 0 0)");
+         }
+         exaconstit::kernel::CubicFamilyNormals(lattice_hkls[f], normals);
+         lattice_fam_offsets[f + 1] = normals.size() / 3;
+      }
+      lattice_normals.SetSize(normals.size(), Device::GetMemoryType());
+      lattice_normals.UseDevice(true);
+      double* normal_data = lattice_normals.HostWrite();
+      for (size_t i = 0; i < normals.size(); i++) {
+         normal_data[i] = normals[i];
+      }
+
+      lattice_dir_vecs.SetSize(3 * lattice_dirs.size(), Device::GetMemoryType());
+      lattice_dir_vecs.UseDevice(true);
+      double* dir_data = lattice_dir_vecs.HostWrite();
+      for (size_t d = 0; d < lattice_dirs.size(); d++) {
+         const double norm = sqrt(lattice_dirs[d][0] * lattice_dirs[d][0] +
+                                  lattice_dirs[d][1] * lattice_dirs[d][1] +
+                                  lattice_dirs[d][2] * lattice_dirs[d][2]);
+         if (norm == 0.0) {
+            MFEM_ABORT("Visualizations.LatticeStrains.directions can't contain a zero vector");
+         }
+         for (int i = 0; i < 3; i++) {
+            dir_data[3 * d + i] = lattice_dirs[d][i] / norm;
+         }
+      }
+   }
+
+   histograms = options.histograms;
+   hist_fields = options.hist_fields;
+   hist_nbins = options.hist_nbins;
+   hist_fname = options.hist_fname;
+   texture = options.histograms && options.texture;
+   texture_nbins = options.texture_nbins;
+   texture_fname = options.texture_fname;
+   texture_nsyms = 0;
+   if (histograms) {
+      const int nfields = hist_fields.size();
+      auto qf_mapping = model->GetQFMapping();
+      hist_field_inds.SetSize(nfields);
+      hist_ranges.SetSize(2 * nfields);
+      hist_ranges.UseDevice(true);
+      for (int k = 0; k < nfields; k++) {
+         const std::string &name = hist_fields[k];
+         if (name == "von_mises") {
+            hist_field_inds[k] = -1;
+         }
+         else if (name == "hydro") {
+            hist_field_inds[k] = -2;
+         }
+         else {
+            auto item = qf_mapping->find(name);
+            if (item == qf_mapping->end() || item->second.second != 1) {
+               MFEM_ABORT("Visualizations.Histograms.fields has a field, " << name << ", that isn't an available scalar field");
+            }
+            hist_field_inds[k] = item->second.first;
+         }
+         hist_ranges[2 * k] = options.hist_ranges[k][0];
+         hist_ranges[2 * k + 1] = options.hist_ranges[k][1];
+      }
+
+      if (texture) {
+         std::vector<double> syms;
+         if (options.texture_sym) {
+            exaconstit::kernel::CrystalSymmetries(options.xtal_type, syms);
+         }
+         else {
+            syms = { 1.0, 0.0, 0.0, 0.0 };
+         }
+         texture_nsyms = syms.size() / 4;
+         texture_syms.SetSize(syms.size());
+         texture_syms.UseDevice(true);
+         for (size_t i = 0; i < syms.size(); i++) {
+            texture_syms[i] = syms[i];
+         }
+         // The bounds of the binned region in Rodrigues space, which contain the fundamental
+         // region of the crystal symmetry. Without the symmetry reduction the vector part of
+         // the quaternions is binned instead, which is bounded by 1.
+         texture_rmax[0] = texture_rmax[1] = texture_rmax[2] = 1.0;
+         if (options.texture_sym) {
+            if (options.xtal_type == XtalType::HCP) {
+               texture_rmax[2] = 2.0 - sqrt(3.0);
+            }
+            else {
+               texture_rmax[0] = texture_rmax[1] = texture_rmax[2] = sqrt(2.0) - 1.0;
+            }
+         }
+      }
+   }
+
+   // The element averages are only computed when one of the Project* methods needs them
+   postprocessing = options.visit || options.conduit || options.paraview || options.adios2;
+   evec_current = false;
 }
 
 const Array<int> &SystemDriver::GetEssTDofList()
@@ -219,115 +386,744 @@ void SystemDriver::UpdateModel()
       model->UpdateStateVars();
    }
 
+   // The averages from the previous time step need to be finished up before
+   // their buffers can be reused.
+   FinalizeVolAvgs();
+
    {
-      CALI_CXX_MARK_SCOPE("avg_stress_computation");
-      // Here we're getting the average stress value
-      Vector stress(6);
-      stress = 0.0;
+      CALI_CXX_MARK_SCOPE("avg_computations");
+      // All of the averaged quantities are summed up in a single pass over each of
+      // them, and the order they're added here is the order FinalizeVolAvgs expects.
+      // Only the components that are written out are summed and reduced.
+      std::vector<const QuadratureFunction*> qfs;
+      std::vector<std::pair<int, int> > comps;
+      std::vector<bool> soa;
+
+      qfs.push_back(model->GetStress0());
+      comps.push_back(std::make_pair(0, model->GetStress0()->GetVDim()));
+      soa.push_back(false);
+
+      if (mech_type == MechType::EXACMECH && additional_avgs) {
+         // The plastic work is the only state variable that's written out
+         std::string s_pl_work = "pl_work";
+         auto qf_mapping = model->GetQFMapping();
+         auto pair = qf_mapping->find(s_pl_work)->second;
+
+         qfs.push_back(model->GetMatVars0());
+         comps.push_back(std::make_pair(pair.first, 1));
+         soa.push_back(model->IsStateVarsSoA());
+         mech_operator->CalculateDeformationGradient(def_grad);
+      }
+
+      if (additional_avgs) {
+         qfs.push_back(&def_grad);
+         comps.push_back(std::make_pair(0, def_grad.GetVDim()));
+         soa.push_back(false);
+      }
+
+      if (mech_type == MechType::EXACMECH && additional_avgs) {
+         model->calcDpMat(*dp_mat);
+         qfs.push_back(dp_mat);
+         comps.push_back(std::make_pair(0, dp_mat->GetVDim()));
+         soa.push_back(false);
+      }
 
-      const QuadratureFunction *qstress = model->GetStress0();
+      int ncomps = 1;
+      for (auto &comp : comps) {
+         ncomps += comp.second;
+      }
+      vol_sums_loc.resize(ncomps);
+      vol_sums_glob.resize(ncomps);
+
+      exaconstit::kernel::ComputeVolSums(fes, qfs, comps, soa, vol_elem_sums, vol_sums_loc.data());
+      // Only a single reduction is needed for all of the quantities, and it's left to finish
+      // in the background while the next time step is being solved.
+      MPI_Iallreduce(vol_sums_loc.data(), vol_sums_glob.data(), ncomps, MPI_DOUBLE, MPI_SUM,
+                     MPI_COMM_WORLD, &vol_sums_req);
+      vol_sums_pending = true;
+   }
+
+   // The state variables have changed so any element averages of them are now out of date
+   evec_current = false;
+}
 
-      exaconstit::kernel::ComputeVolAvgTensor<true>(fes, qstress, stress, 6, class_device);
+void SystemDriver::FinalizeVolAvgs()
+{
+   if (!vol_sums_pending) {
+      return;
+   }
 
-      cout.setf(ios::fixed);
-      cout.setf(ios::showpoint);
-      cout.precision(8);
+   CALI_CXX_MARK_SCOPE("avg_output");
+   MPI_Wait(&vol_sums_req, MPI_STATUS_IGNORE);
+   vol_sums_pending = false;
 
-      int my_id;
-      MPI_Comm_rank(MPI_COMM_WORLD, &my_id);
-      // Now we're going to save off the average stress tensor to a file
-      if (my_id == 0) {
-         std::ofstream file;
+   // Now we're going to save off the averages to their files
+   if (myid != 0) {
+      return;
+   }
 
-         file.open(avg_stress_fname, std::ios_base::app);
+   cout.setf(ios::fixed);
+   cout.setf(ios::showpoint);
+   cout.precision(8);
 
-         stress.Print(file, 6);
+   // We need to multiply our tensor values by 1/V to get the appropriate
+   // average value for the tensor in the end.
+   const double inv_vol = 1.0 / vol_sums_glob[0];
+   int offset = 1;
+
+   {
+      Vector stress(6);
+      for (int i = 0; i < 6; i++) {
+         stress[i] = vol_sums_glob[offset + i] * inv_vol;
       }
+      offset += 6;
+
+      std::ofstream file;
+      file.open(avg_stress_fname, std::ios_base::app);
+      stress.Print(file, 6);
    }
 
    if (mech_type == MechType::EXACMECH && additional_avgs) {
-      CALI_CXX_MARK_SCOPE("extra_avgs_computations");
-      const QuadratureFunction *qstate_var = model->GetMatVars0();
-      // Here we're getting the average stress value
-      Vector state_var(qstate_var->GetVDim());
-      state_var = 0.0;
+      // The plastic work is the total over the volume and not an average
+      std::ofstream file;
+      file.open(avg_pl_work_fname, std::ios_base::app);
+      file << vol_sums_glob[offset] << std::endl;
+      offset += 1;
+   }
 
-      std::string s_pl_work = "pl_work";
-      auto qf_mapping = model->GetQFMapping();
-      auto pair = qf_mapping->find(s_pl_work)->second;
+   if (additional_avgs) {
+      const int vdim = def_grad.GetVDim();
+      Vector dgrad(vdim);
+      for (int i = 0; i < vdim; i++) {
+         dgrad[i] = vol_sums_glob[offset + i] * inv_vol;
+      }
+      offset += vdim;
 
-      exaconstit::kernel::ComputeVolAvgTensor<false>(fes, qstate_var, state_var, state_var.Size(), class_device);
+      std::ofstream file;
+      file.open(avg_def_grad_fname, std::ios_base::app);
+      dgrad.Print(file, dgrad.Size());
+   }
 
-      cout.setf(ios::fixed);
-      cout.setf(ios::showpoint);
-      cout.precision(8);
+   if (mech_type == MechType::EXACMECH && additional_avgs) {
+      const int vdim = dp_mat->GetVDim();
+      Vector dp(vdim);
+      for (int i = 0; i < vdim; i++) {
+         dp[i] = vol_sums_glob[offset + i] * inv_vol;
+      }
+      offset += vdim;
 
-      int my_id;
-      MPI_Comm_rank(MPI_COMM_WORLD, &my_id);
-      // Now we're going to save off the average stress tensor to a file
-      if (my_id == 0) {
-         std::ofstream file;
-         file.open(avg_pl_work_fname, std::ios_base::app);
-         file << state_var[pair.first] << std::endl;
+      std::ofstream file;
+      file.open(avg_dp_tensor_fname, std::ios_base::app);
+      dp.Print(file, dp.Size());
+   }
+}
+
+bool SystemDriver::HasQptField(const std::string &name)
+{
+   auto qf_mapping = model->GetQFMapping();
+   return (name == "stress" || name == "def_grad" || name == "state_vars" ||
+           qf_mapping->find(name) != qf_mapping->end());
+}
+
+void SystemDriver::GetQptField(const std::string &name, const QuadratureFunction *&qf,
+                               int &offset, int &ncomps, bool &soa)
+{
+   offset = 0;
+   soa = false;
+   if (name == "stress") {
+      qf = model->GetStress0();
+      ncomps = qf->GetVDim();
+   }
+   else if (name == "def_grad") {
+      // The ExaCMech models don't track the deformation gradient, so it's calculated here.
+      // The UMAT's kinematic variables already contain it.
+      if (mech_type == MechType::EXACMECH) {
+         mech_operator->CalculateDeformationGradient(def_grad);
+      }
+      qf = &def_grad;
+      ncomps = qf->GetVDim();
+   }
+   else {
+      qf = model->GetMatVars0();
+      soa = model->IsStateVarsSoA();
+      ncomps = qf->GetVDim();
+      if (name != "state_vars") {
+         auto pair = model->GetQFMapping()->find(name)->second;
+         offset = pair.first;
+         ncomps = pair.second;
       }
-      mech_operator->CalculateDeformationGradient(def_grad);
    }
+}
 
-   if (additional_avgs)
-   {
-      CALI_CXX_MARK_SCOPE("extra_avgs_def_grad_computation");
-      const QuadratureFunction *qstate_var = &def_grad;
-      // Here we're getting the average stress value
-      Vector dgrad(qstate_var->GetVDim());
-      dgrad = 0.0;
-
-      exaconstit::kernel::ComputeVolAvgTensor<true>(fes, qstate_var, dgrad, dgrad.Size(), class_device);
-
-      cout.setf(ios::fixed);
-      cout.setf(ios::showpoint);
-      cout.precision(8);
-
-      int my_id;
-      MPI_Comm_rank(MPI_COMM_WORLD, &my_id);
-      // Now we're going to save off the average stress tensor to a file
-      if (my_id == 0) {
-         std::ofstream file;
-         file.open(avg_def_grad_fname, std::ios_base::app);
-         dgrad.Print(file, dgrad.Size());
+void SystemDriver::WriteRawQpts(const int cycle, const double time)
+{
+   if (!raw_qpts) {
+      return;
+   }
+
+   CALI_CXX_MARK_SCOPE("raw_qpts_output");
+
+   const QuadratureFunction *qstress = model->GetStress0();
+   const int npts = qstress->Size() / qstress->GetVDim();
+   const int nelems = fe_space.GetNE();
+   const int nqpts = npts / nelems;
+
+   // Find out where each field lives and how large it is
+   const int nfields = raw_qpt_fields.size();
+   std::vector<const QuadratureFunction*> qfs(nfields);
+   std::vector<int> offsets(nfields);
+   std::vector<int> ncomps(nfields);
+   std::vector<bool> soas(nfields);
+   int tot_comps = 0;
+
+   for (int k = 0; k < nfields; k++) {
+      const QuadratureFunction *qf;
+      int offset, ncomp;
+      bool soa;
+      GetQptField(raw_qpt_fields[k], qf, offset, ncomp, soa);
+      qfs[k] = qf;
+      offsets[k] = offset;
+      ncomps[k] = ncomp;
+      soas[k] = soa;
+      tot_comps += ncomp;
+   }
+
+   // Everything is gathered into a point-major buffer on the device, so only a
+   // single transfer back to the host is needed.
+   raw_qpt_buf.SetSize(tot_comps * npts, Device::GetMemoryType());
+   raw_qpt_buf.UseDevice(true);
+   double* buf_data = raw_qpt_buf.Write();
+   int buf_offset = 0;
+   for (int k = 0; k < nfields; k++) {
+      const int vdim = qfs[k]->GetVDim();
+      const bool soa = soas[k];
+      const int pt_stride = soa ? 1 : vdim;
+      const int comp_stride = soa ? npts : 1;
+      const int qf_offset = offsets[k];
+      const int ncomp = ncomps[k];
+      const double* qf_data = qfs[k]->Read();
+      double* field_data = &buf_data[buf_offset];
+
+      MFEM_FORALL(i, npts, {
+         for (int m = 0; m < ncomp; m++) {
+            field_data[i * ncomp + m] = qf_data[i * pt_stride + (qf_offset + m) * comp_stride];
+         }
+      });
+      buf_offset += ncomp * npts;
+   }
+
+   std::ostringstream fname;
+   fname << raw_qpt_dir << "/qpts_" << std::setw(6) << std::setfill('0') << cycle
+         << "." << std::setw(6) << std::setfill('0') << myid << ".bin";
+   std::ofstream file(fname.str(), std::ios::out | std::ios::binary);
+   if (!file.is_open()) {
+      MFEM_WARNING("Unable to open " << fname.str() << " for the raw quadrature point output");
+      return;
+   }
+
+   const int32_t version = 1;
+   const int32_t cycle32 = cycle;
+   const int64_t nelems64 = nelems;
+   const int64_t elem_offset = raw_qpt_elem_offset;
+   const int32_t nqpts32 = nqpts;
+   const int32_t nfields32 = nfields;
+   char magic[8] = "EXAQPTS";
+
+   file.write(magic, sizeof(magic));
+   file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+   file.write(reinterpret_cast<const char*>(&cycle32), sizeof(cycle32));
+   file.write(reinterpret_cast<const char*>(&time), sizeof(time));
+   file.write(reinterpret_cast<const char*>(&nelems64), sizeof(nelems64));
+   file.write(reinterpret_cast<const char*>(&elem_offset), sizeof(elem_offset));
+   file.write(reinterpret_cast<const char*>(&nqpts32), sizeof(nqpts32));
+   file.write(reinterpret_cast<const char*>(&nfields32), sizeof(nfields32));
+
+   const int64_t header_size = sizeof(magic) + 3 * sizeof(int32_t) + sizeof(double) +
+                               2 * sizeof(int64_t) + sizeof(int32_t) +
+                               nfields * (32 + sizeof(int32_t) + sizeof(int64_t));
+   int64_t data_offset = header_size;
+   for (int k = 0; k < nfields; k++) {
+      char name[32];
+      std::memset(name, 0, sizeof(name));
+      std::strncpy(name, raw_qpt_fields[k].c_str(), sizeof(name) - 1);
+      const int32_t ncomp = ncomps[k];
+      file.write(name, sizeof(name));
+      file.write(reinterpret_cast<const char*>(&ncomp), sizeof(ncomp));
+      file.write(reinterpret_cast<const char*>(&data_offset), sizeof(data_offset));
+      data_offset += (int64_t) ncomp * npts * sizeof(double);
+   }
+
+   file.write(reinterpret_cast<const char*>(raw_qpt_buf.HostRead()), raw_qpt_buf.Size() * sizeof(double));
+}
+
+void SystemDriver::WriteGrainStats(const int cycle, const double time)
+{
+   if (!grain_stats) {
+      return;
+   }
+
+   CALI_CXX_MARK_SCOPE("grain_stats");
+
+   Mesh *mesh = fe_space.GetMesh();
+   const FiniteElement &el = *fe_space.GetFE(0);
+   const IntegrationRule *ir = &(IntRules.Get(el.GetGeomType(), 2 * el.GetOrder() + 1));
+
+   const int nqpts = ir->GetNPoints();
+   const int nelems = fe_space.GetNE();
+   const int npts = nqpts * nelems;
+   const int nfields = grain_stats_fields.size();
+
+   std::vector<const QuadratureFunction*> qfs(nfields);
+   std::vector<int> offsets(nfields);
+   std::vector<int> ncomps(nfields);
+   std::vector<bool> soas(nfields);
+   int tot_comps = 0;
+
+   for (int k = 0; k < nfields; k++) {
+      const QuadratureFunction *qf;
+      int offset, ncomp;
+      bool soa;
+      GetQptField(grain_stats_fields[k], qf, offset, ncomp, soa);
+      qfs[k] = qf;
+      offsets[k] = offset;
+      ncomps[k] = ncomp;
+      soas[k] = soa;
+      tot_comps += ncomp;
+   }
+
+   // The columns are the volume, the sums of each component, and then the sums
+   // of each component squared if the second moments are wanted
+   const int ncols = 1 + (grain_stats_moments ? 2 : 1) * tot_comps;
+   const bool moments = grain_stats_moments;
+
+   const double* W = ir->GetWeights().Read();
+   const GeometricFactors *geom = mesh->GetGeometricFactors(*ir, GeometricFactors::DETERMINANTS);
+
+   grain_elem_sums.SetSize(ncols * nelems, Device::GetMemoryType());
+   grain_elem_sums.UseDevice(true);
+
+   const int DIM2 = 2;
+   std::array<RAJA::idx_t, DIM2> perm2 {{ 1, 0 } };
+   RAJA::Layout<DIM2> layout_geom = RAJA::make_permuted_layout({{ nqpts, nelems } }, perm2);
+   RAJA::Layout<DIM2> layout_sums = RAJA::make_permuted_layout({{ ncols, nelems } }, perm2);
+   RAJA::View<const double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > j_view(geom->detJ.Read(), layout_geom);
+   RAJA::View<double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > sums_view(grain_elem_sums.Write(), layout_sums);
+
+   MFEM_FORALL(i, nelems, {
+      double vol = 0.0;
+      for (int j = 0; j < nqpts; j++) {
+         vol += j_view(j, i) * W[j];
       }
+      sums_view(0, i) = vol;
+   });
+
+   int col = 1;
+   for (int k = 0; k < nfields; k++) {
+      const int vdim = qfs[k]->GetVDim();
+      const int pt_stride = soas[k] ? 1 : vdim;
+      const int comp_stride = soas[k] ? npts : 1;
+      const int qf_offset = offsets[k];
+      const int ncomp = ncomps[k];
+      const int mean_col = col;
+      const int sq_col = col + tot_comps;
+      const double* qf_data = qfs[k]->Read();
+
+      MFEM_FORALL(i, nelems, {
+         for (int m = 0; m < ncomp; m++) {
+            double sum = 0.0;
+            double sq_sum = 0.0;
+            for (int j = 0; j < nqpts; j++) {
+               const double wts = j_view(j, i) * W[j];
+               const double val = qf_data[(i * nqpts + j) * pt_stride + (qf_offset + m) * comp_stride];
+               sum += wts * val;
+               sq_sum += wts * val * val;
+            }
+            sums_view(mean_col + m, i) = sum;
+            if (moments) {
+               sums_view(sq_col + m, i) = sq_sum;
+            }
+         }
+      });
+      col += ncomp;
    }
 
-   if (mech_type == MechType::EXACMECH && additional_avgs) {
-      CALI_CXX_MARK_SCOPE("extra_avgs_dp_tensor_computation");
+   // The element sums are binned by their grain on the host, since the number of grains
+   // is typically much smaller than the number of elements.
+   const int ngrains = grain_stats_ngrains;
+   std::vector<double> grain_sums(ngrains * ncols, 0.0);
+   const double* elem_data = grain_elem_sums.HostRead();
+   for (int i = 0; i < nelems; i++) {
+      const int grain = mesh->GetAttribute(i) - 1;
+      for (int m = 0; m < ncols; m++) {
+         grain_sums[grain * ncols + m] += elem_data[i * ncols + m];
+      }
+   }
+
+   std::vector<double> grain_sums_glob;
+   if (myid == 0) {
+      grain_sums_glob.resize(ngrains * ncols);
+   }
+   MPI_Reduce(grain_sums.data(), grain_sums_glob.data(), ngrains * ncols, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+   if (myid == 0) {
+      std::ofstream file;
+      file.open(grain_stats_fname, std::ios_base::app);
+      file.setf(std::ios::scientific);
+      file.precision(8);
+      for (int g = 0; g < ngrains; g++) {
+         const double vol = grain_sums_glob[g * ncols];
+         // Attributes that don't have any elements aren't grains
+         if (vol <= 0.0) {
+            continue;
+         }
+         const double inv_vol = 1.0 / vol;
+         file << cycle << " " << time << " " << (g + 1) << " " << vol;
+         for (int m = 1; m < ncols; m++) {
+            file << " " << grain_sums_glob[g * ncols + m] * inv_vol;
+         }
+         file << std::endl;
+      }
+   }
+}
+
+void SystemDriver::WriteLatticeStrains(const int cycle, const double time)
+{
+   if (!lattice_strains) {
+      return;
+   }
+
+   CALI_CXX_MARK_SCOPE("lattice_strains");
+
+   Mesh *mesh = fe_space.GetMesh();
+   const FiniteElement &el = *fe_space.GetFE(0);
+   const IntegrationRule *ir = &(IntRules.Get(el.GetGeomType(), 2 * el.GetOrder() + 1));
+
+   const int nqpts = ir->GetNPoints();
+   const int nelems = fe_space.GetNE();
+   const int npts = nqpts * nelems;
+
+   const int nfams = lattice_hkls.size();
+   const int ndirs = lattice_dirs.size();
+   const int nbins = nfams * ndirs;
+   // The columns are the total volume and then the volume, the volume weighted sum of the
+   // lattice strains, and the volume weighted sum of the lattice strains squared of each bin
+   const int ncols = 1 + 3 * nbins;
+
+   auto qf_mapping = model->GetQFMapping();
+   const int ind_quats = qf_mapping->find("quats")->second.first;
+   const int ind_elas = qf_mapping->find("dev_elas_strain")->second.first;
+   const int ind_rvol = qf_mapping->find("rel_vol")->second.first;
+
+   const QuadratureFunction *qstate_vars = model->GetMatVars0();
+   const int vdim = qstate_vars->GetVDim();
+   const bool soa = model->IsStateVarsSoA();
+   const int pt_stride = soa ? 1 : vdim;
+   const int comp_stride = soa ? npts : 1;
+   const double cos_tol = lattice_cos_tol;
+
+   const double* W = ir->GetWeights().Read();
+   const GeometricFactors *geom = mesh->GetGeometricFactors(*ir, GeometricFactors::DETERMINANTS);
+
+   lattice_elem_sums.SetSize(ncols * nelems, Device::GetMemoryType());
+   lattice_elem_sums.UseDevice(true);
+
+   const int DIM2 = 2;
+   std::array<RAJA::idx_t, DIM2> perm2 {{ 1, 0 } };
+   RAJA::Layout<DIM2> layout_geom = RAJA::make_permuted_layout({{ nqpts, nelems } }, perm2);
+   RAJA::Layout<DIM2> layout_sums = RAJA::make_permuted_layout({{ ncols, nelems } }, perm2);
+   RAJA::View<const double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > j_view(geom->detJ.Read(), layout_geom);
+   RAJA::View<double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > sums_view(lattice_elem_sums.Write(), layout_sums);
+
+   const double* sv_data = qstate_vars->Read();
+   const double* normals = lattice_normals.Read();
+   const int* fam_offsets = lattice_fam_offsets.Read();
+   const double* dirs = lattice_dir_vecs.Read();
+
+   MFEM_FORALL(i, nelems, {
+      for (int m = 0; m < ncols; m++) {
+         sums_view(m, i) = 0.0;
+      }
+      for (int j = 0; j < nqpts; j++) {
+         const double wts = j_view(j, i) * W[j];
+         const int ipt = (i * nqpts + j) * pt_stride;
+         sums_view(0, i) += wts;
+
+         // Rotation from the crystal frame to the sample frame
+         double quat[ecmech::qdim];
+         for (int k = 0; k < ecmech::qdim; k++) {
+            quat[k] = sv_data[ipt + (ind_quats + k) * comp_stride];
+         }
+         double rmat[ecmech::ndim * ecmech::ndim];
+         ecmech::quat_to_tensor(rmat, quat);
+
+         // The deviatoric elastic strain is in the crystal frame and in ExaCMech's vecd format.
+         // The plastic deformation is isochoric so the volumetric elastic strain comes from the
+         // relative volume.
+         double vecd[ecmech::ntvec];
+         for (int k = 0; k < ecmech::ntvec; k++) {
+            vecd[k] = sv_data[ipt + (ind_elas + k) * comp_stride];
+         }
+         const double evol = log(sv_data[ipt + ind_rvol * comp_stride]) / 3.0;
+         double elas[9];
+         exaconstit::kernel::VecdToTensor(vecd, evol, elas);
+
+         for (int f = 0; f < nfams; f++) {
+            for (int d = 0; d < ndirs; d++) {
+               const double* dir = &dirs[3 * d];
+               for (int n = fam_offsets[f]; n < fam_offsets[f + 1]; n++) {
+                  const double* nrm = &normals[3 * n];
+                  double proj = 0.0;
+                  for (int k = 0; k < 3; k++) {
+                     proj += dir[k] * (rmat[3 * k] * nrm[0] + rmat[3 * k + 1] * nrm[1] + rmat[3 * k + 2] * nrm[2]);
+                  }
+                  // Each point contributes at most once to a bin
+                  if (fabs(proj) >= cos_tol) {
+                     double eps = 0.0;
+                     for (int k = 0; k < 3; k++) {
+                        for (int l = 0; l < 3; l++) {
+                           eps += nrm[k] * elas[3 * k + l] * nrm[l];
+                        }
+                     }
+                     const int col = 1 + 3 * (f * ndirs + d);
+                     sums_view(col, i) += wts;
+                     sums_view(col + 1, i) += wts * eps;
+                     sums_view(col + 2, i) += wts * eps * eps;
+                     break;
+                  }
+               }
+            }
+         }
+      }
+   });
+
+   std::vector<double> sums(ncols, 0.0);
+   const double* elem_data = lattice_elem_sums.HostRead();
+   for (int i = 0; i < nelems; i++) {
+      for (int m = 0; m < ncols; m++) {
+         sums[m] += elem_data[i * ncols + m];
+      }
+   }
+
+   std::vector<double> sums_glob;
+   if (myid == 0) {
+      sums_glob.resize(ncols);
+   }
+   MPI_Reduce(sums.data(), sums_glob.data(), ncols, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+   if (myid == 0) {
+      std::ofstream file;
+      file.open(lattice_fname, std::ios_base::app);
+      file.setf(std::ios::scientific);
+      file.precision(8);
+      const double inv_tot_vol = 1.0 / sums_glob[0];
+      for (int f = 0; f < nfams; f++) {
+         for (int d = 0; d < ndirs; d++) {
+            const int col = 1 + 3 * (f * ndirs + d);
+            const double vol = sums_glob[col];
+            double mean = 0.0;
+            double std_dev = 0.0;
+            if (vol > 0.0) {
+               mean = sums_glob[col + 1] / vol;
+               std_dev = sqrt(fmax(sums_glob[col + 2] / vol - mean * mean, 0.0));
+            }
+            file << cycle << " " << time << " "
+                 << lattice_hkls[f][0] << " " << lattice_hkls[f][1] << " " << lattice_hkls[f][2] << " "
+                 << lattice_dirs[d][0] << " " << lattice_dirs[d][1] << " " << lattice_dirs[d][2] << " "
+                 << vol * inv_tot_vol << " " << mean << " " << std_dev << std::endl;
+         }
+      }
+   }
+}
+
+void SystemDriver::WriteHistograms(const int cycle, const double time)
+{
+   if (!histograms) {
+      return;
+   }
+
+   CALI_CXX_MARK_SCOPE("histograms");
+
+   Mesh *mesh = fe_space.GetMesh();
+   const FiniteElement &el = *fe_space.GetFE(0);
+   const IntegrationRule *ir = &(IntRules.Get(el.GetGeomType(), 2 * el.GetOrder() + 1));
+
+   const int nqpts = ir->GetNPoints();
+   const int nelems = fe_space.GetNE();
+   const int npts = nqpts * nelems;
+
+   const int nfields = hist_fields.size();
+   const int nbins = hist_nbins;
+   const int tex_nbins = texture ? texture_nbins : 0;
+   const int tex_size = tex_nbins * tex_nbins * tex_nbins;
+   // The total volume is first followed by each field's bins and then the texture bins
+   const int tex_offset = 1 + nfields * nbins;
+   const int hist_size = tex_offset + tex_size;
+
+   const QuadratureFunction *qstress = model->GetStress0();
+   const QuadratureFunction *qstate_vars = model->GetMatVars0();
+   const int vdim = qstate_vars->GetVDim();
+   const bool soa = model->IsStateVarsSoA();
+   const int pt_stride = soa ? 1 : vdim;
+   const int comp_stride = soa ? npts : 1;
+   int ind_quats = 0;
+   if (texture) {
+      ind_quats = model->GetQFMapping()->find("quats")->second.first;
+   }
+   const int nsyms = texture_nsyms;
+   const double rmax0 = texture_rmax[0];
+   const double rmax1 = texture_rmax[1];
+   const double rmax2 = texture_rmax[2];
 
-      model->calcDpMat(def_grad);
-      const QuadratureFunction *qstate_var = &def_grad;
-      // Here we're getting the average stress value
-      Vector dgrad(qstate_var->GetVDim());
-      dgrad = 0.0;
+   const double* W = ir->GetWeights().Read();
+   const GeometricFactors *geom = mesh->GetGeometricFactors(*ir, GeometricFactors::DETERMINANTS);
+
+   hist_data.SetSize(hist_size, Device::GetMemoryType());
+   hist_data.UseDevice(true);
+   hist_data = 0.0;
+   hist_elem_vols.SetSize(nelems, Device::GetMemoryType());
+   hist_elem_vols.UseDevice(true);
+
+   const int DIM2 = 2;
+   std::array<RAJA::idx_t, DIM2> perm2 {{ 1, 0 } };
+   RAJA::Layout<DIM2> layout_geom = RAJA::make_permuted_layout({{ nqpts, nelems } }, perm2);
+   RAJA::View<const double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > j_view(geom->detJ.Read(), layout_geom);
+
+   const double* stress_data = qstress->Read();
+   const double* sv_data = qstate_vars->Read();
+   const int* field_inds = hist_field_inds.Read();
+   const double* ranges = hist_ranges.Read();
+   const double* syms = texture ? texture_syms.Read() : nullptr;
+   double* hist = hist_data.ReadWrite();
+   double* elem_vols = hist_elem_vols.Write();
+
+   // Different points can land in the same bin, so the bins are updated atomically.
+   // The volume is summed up per element instead, since every point would contribute to it.
+   MFEM_FORALL(i, nelems, {
+      double vol = 0.0;
+      for (int j = 0; j < nqpts; j++) {
+         const double wts = j_view(j, i) * W[j];
+         const int ipt = i * nqpts + j;
+         vol += wts;
+
+         for (int k = 0; k < nfields; k++) {
+            double val;
+            if (field_inds[k] >= 0) {
+               val = sv_data[ipt * pt_stride + field_inds[k] * comp_stride];
+            }
+            else {
+               const double* sig = &stress_data[ipt * 6];
+               if (field_inds[k] == -1) {
+                  const double t1 = sig[0] - sig[1];
+                  const double t2 = sig[1] - sig[2];
+                  const double t3 = sig[2] - sig[0];
+                  const double t4 = sig[3] * sig[3] + sig[4] * sig[4] + sig[5] * sig[5];
+                  val = sqrt(0.5 * (t1 * t1 + t2 * t2 + t3 * t3 + 6.0 * t4));
+               }
+               else {
+                  val = (sig[0] + sig[1] + sig[2]) / 3.0;
+               }
+            }
+            int bin = (int) floor((val - ranges[2 * k]) / (ranges[2 * k + 1] - ranges[2 * k]) * nbins);
+            bin = (bin < 0) ? 0 : ((bin >= nbins) ? nbins - 1 : bin);
+            RAJA::atomicAdd<RAJA::auto_atomic>(&hist[1 + k * nbins + bin], wts);
+         }
 
-      exaconstit::kernel::ComputeVolAvgTensor<true>(fes, qstate_var, dgrad, dgrad.Size(), class_device);
+         if (tex_nbins > 0) {
+            double quat[4];
+            for (int k = 0; k < 4; k++) {
+               quat[k] = sv_data[ipt * pt_stride + (ind_quats + k) * comp_stride];
+            }
+            // The symmetric equivalent with the smallest rotation angle lies in the fundamental region
+            double qfr[4] = { 0.0, 0.0, 0.0, 0.0 };
+            double max_q0 = -1.0;
+            for (int isym = 0; isym < nsyms; isym++) {
+               const double* sq = &syms[4 * isym];
+               double qe[4];
+               qe[0] = quat[0] * sq[0] - quat[1] * sq[1] - quat[2] * sq[2] - quat[3] * sq[3];
+               qe[1] = quat[0] * sq[1] + quat[1] * sq[0] + quat[2] * sq[3] - quat[3] * sq[2];
+               qe[2] = quat[0] * sq[2] - quat[1] * sq[3] + quat[2] * sq[0] + quat[3] * sq[1];
+               qe[3] = quat[0] * sq[3] + quat[1] * sq[2] - quat[2] * sq[1] + quat[3] * sq[0];
+               if (fabs(qe[0]) > max_q0) {
+                  max_q0 = fabs(qe[0]);
+                  const double sgn = (qe[0] < 0.0) ? -1.0 : 1.0;
+                  for (int k = 0; k < 4; k++) {
+                     qfr[k] = sgn * qe[k];
+                  }
+               }
+            }
+            const double qnorm = sqrt(qfr[0] * qfr[0] + qfr[1] * qfr[1] + qfr[2] * qfr[2] + qfr[3] * qfr[3]);
+            // Either the Rodrigues vector or the vector part of the quaternion
+            double rvec[3];
+            const double rscale = (nsyms > 1) ? 1.0 / fmax(qfr[0], 1e-12) : 1.0 / qnorm;
+            for (int k = 0; k < 3; k++) {
+               rvec[k] = qfr[k + 1] * rscale;
+            }
+            const double rmax[3] = { rmax0, rmax1, rmax2 };
+            int tbin[3];
+            for (int k = 0; k < 3; k++) {
+               int b = (int) floor((rvec[k] + rmax[k]) / (2.0 * rmax[k]) * tex_nbins);
+               tbin[k] = (b < 0) ? 0 : ((b >= tex_nbins) ? tex_nbins - 1 : b);
+            }
+            const int ibin = tbin[0] + tex_nbins * (tbin[1] + tex_nbins * tbin[2]);
+            RAJA::atomicAdd<RAJA::auto_atomic>(&hist[tex_offset + ibin], wts);
+         }
+      }
+      elem_vols[i] = vol;
+   });
 
-      cout.setf(ios::fixed);
-      cout.setf(ios::showpoint);
-      cout.precision(8);
+   double* hist_host = hist_data.HostReadWrite();
+   const double* elem_vols_host = hist_elem_vols.HostRead();
+   for (int i = 0; i < nelems; i++) {
+      hist_host[0] += elem_vols_host[i];
+   }
+   std::vector<double> hist_glob;
+   if (myid == 0) {
+      hist_glob.resize(hist_size);
+   }
+   MPI_Reduce(hist_host, hist_glob.data(), hist_size, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
 
-      int my_id;
-      MPI_Comm_rank(MPI_COMM_WORLD, &my_id);
-      // Now we're going to save off the average dp tensor to a file
-      if (my_id == 0) {
+   if (myid == 0) {
+      const double inv_vol = 1.0 / hist_glob[0];
+      const double* range_data = hist_ranges.HostRead();
+      if (nfields > 0) {
          std::ofstream file;
-         file.open(avg_dp_tensor_fname, std::ios_base::app);
-         dgrad.Print(file, dgrad.Size());
+         file.open(hist_fname, std::ios_base::app);
+         file.setf(std::ios::scientific);
+         file.precision(8);
+         for (int k = 0; k < nfields; k++) {
+            file << cycle << " " << time << " " << hist_fields[k] << " "
+                 << range_data[2 * k] << " " << range_data[2 * k + 1];
+            for (int b = 0; b < nbins; b++) {
+               file << " " << hist_glob[1 + k * nbins + b] * inv_vol;
+            }
+            file << std::endl;
+         }
+      }
+      if (texture) {
+         std::ofstream file;
+         file.open(texture_fname, std::ios_base::app);
+         file.setf(std::ios::scientific);
+         file.precision(8);
+         file << cycle << " " << time;
+         for (int b = 0; b < tex_size; b++) {
+            file << " " << hist_glob[tex_offset + b] * inv_vol;
+         }
+         file << std::endl;
       }
    }
+}
 
-   if(postprocessing) {
-      CalcElementAvg(evec, model->GetMatVars0());
+void SystemDriver::UpdateElementAvgs()
+{
+   if (postprocessing && !evec_current) {
+      CALI_CXX_MARK_SCOPE("elem_avg_state_vars");
+      CalcElementAvg(evec, model->GetMatVars0(), model->IsStateVarsSoA());
+      evec_current = true;
    }
 }
 
-void SystemDriver::CalcElementAvg(mfem::Vector *elemVal, const mfem::QuadratureFunction *qf)
+void SystemDriver::CalcElementAvg(mfem::Vector *elemVal, const mfem::QuadratureFunction *qf,
+                                  const bool soa)
 {
 
    Mesh *mesh = fe_space.GetMesh();
@@ -345,6 +1141,10 @@ void SystemDriver::CalcElementAvg(mfem::Vector *elemVal, const mfem::QuadratureF
    const int DIM3 = 3;
    std::array<RAJA::idx_t, DIM2> perm2 {{ 1, 0 } };
    std::array<RAJA::idx_t, DIM3> perm3 {{2, 1, 0}};
+   // With the structure of arrays format the vdim index is the slowest index
+   if (soa) {
+      perm3 = {{0, 2, 1}};
+   }
 
    RAJA::Layout<DIM2> layout_geom = RAJA::make_permuted_layout({{ nqpts, nelems } }, perm2);
    RAJA::Layout<DIM2> layout_ev = RAJA::make_permuted_layout({{ vdim, nelems } }, perm2);
@@ -353,7 +1153,7 @@ void SystemDriver::CalcElementAvg(mfem::Vector *elemVal, const mfem::QuadratureF
    (*elemVal) = 0.0;
 
    RAJA::View<const double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > j_view(geom->detJ.Read(), layout_geom);
-   RAJA::View<const double, RAJA::Layout<DIM3, RAJA::Index_type, 0> > qf_view(qf->Read(), layout_qf);
+   RAJA::View<const double, RAJA::Layout<DIM3> > qf_view(qf->Read(), layout_qf);
    RAJA::View<double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > ev_view(elemVal->ReadWrite(), layout_ev);
 
    MFEM_FORALL(i, nelems, {
@@ -372,6 +1172,32 @@ void SystemDriver::CalcElementAvg(mfem::Vector *elemVal, const mfem::QuadratureF
    });
 }
 
+void SystemDriver::ProjectElementAvgs(ParGridFunction &gf, const int offset, const int length)
+{
+   UpdateElementAvgs();
+
+   const int nelems = fe_space.GetNE();
+   const int ev_vdim = evec->GetVDim();
+
+   MFEM_VERIFY(gf.Size() == nelems * length, "ProjectElementAvgs: the grid function must be an order 0 L2 "
+               "field with the same vector dimension as the requested number of components");
+
+   // The order 0 L2 grid functions have a single dof per element with the vector
+   // components next to each other, so this is just a strided copy of the element averages.
+   const int DIM2 = 2;
+   std::array<RAJA::idx_t, DIM2> perm2 {{ 1, 0 } };
+   RAJA::Layout<DIM2> layout_ev = RAJA::make_permuted_layout({{ ev_vdim, nelems } }, perm2);
+   RAJA::Layout<DIM2> layout_gf = RAJA::make_permuted_layout({{ length, nelems } }, perm2);
+   RAJA::View<const double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > ev_view(evec->Read(), layout_ev);
+   RAJA::View<double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > gf_view(gf.Write(), layout_gf);
+
+   MFEM_FORALL(i, nelems, {
+      for (int k = 0; k < length; k++) {
+         gf_view(k, i) = ev_view(offset + k, i);
+      }
+   });
+}
+
 void SystemDriver::ProjectVolume(ParGridFunction &vol)
 {
    Mesh *mesh = fe_space.GetMesh();
@@ -463,9 +1289,7 @@ void SystemDriver::ProjectDpEff(ParGridFunction &dpeff)
       auto qf_mapping = model->GetQFMapping();
       auto pair = qf_mapping->find(s_shrateEff)->second;
 
-      VectorQuadratureFunctionCoefficient qfvc(*evec);
-      qfvc.SetComponent(pair.first, pair.second);
-      dpeff.ProjectDiscCoefficient(qfvc, mfem::GridFunction::ARITHMETIC);
+      ProjectElementAvgs(dpeff, pair.first, pair.second);
    }
    return;
 }
@@ -477,9 +1301,7 @@ void SystemDriver::ProjectEffPlasticStrain(ParGridFunction &pleff)
       auto qf_mapping = model->GetQFMapping();
       auto pair = qf_mapping->find(s_shrEff)->second;
 
-      VectorQuadratureFunctionCoefficient qfvc(*evec);
-      qfvc.SetComponent(pair.first, pair.second);
-      pleff.ProjectDiscCoefficient(qfvc, mfem::GridFunction::ARITHMETIC);
+      ProjectElementAvgs(pleff, pair.first, pair.second);
    }
    return;
 }
@@ -491,9 +1313,80 @@ void SystemDriver::ProjectShearRate(ParGridFunction &gdot)
       auto qf_mapping = model->GetQFMapping();
       auto pair = qf_mapping->find(s_gdot)->second;
 
-      VectorQuadratureFunctionCoefficient qfvc(*evec);
-      qfvc.SetComponent(pair.first, pair.second);
-      gdot.ProjectDiscCoefficient(qfvc, mfem::GridFunction::ARITHMETIC);
+      if (shear_rate_systems.Size() == 0) {
+         ProjectElementAvgs(gdot, pair.first, pair.second);
+         return;
+      }
+
+      UpdateElementAvgs();
+
+      const int nelems = fe_space.GetNE();
+      const int ev_vdim = evec->GetVDim();
+      const int nsys = shear_rate_systems.Size();
+      const int offset = pair.first;
+
+      MFEM_VERIFY(gdot.Size() == nelems * nsys, "ProjectShearRate: the grid function must have "
+                  "a vector component for each of the requested slip systems");
+
+      const int DIM2 = 2;
+      std::array<RAJA::idx_t, DIM2> perm2 {{ 1, 0 } };
+      RAJA::Layout<DIM2> layout_ev = RAJA::make_permuted_layout({{ ev_vdim, nelems } }, perm2);
+      RAJA::Layout<DIM2> layout_gf = RAJA::make_permuted_layout({{ nsys, nelems } }, perm2);
+      RAJA::View<const double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > ev_view(evec->Read(), layout_ev);
+      RAJA::View<double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > gf_view(gdot.Write(), layout_gf);
+      const int *systems = shear_rate_systems.Read();
+
+      MFEM_FORALL(i, nelems, {
+         for (int k = 0; k < nsys; k++) {
+            gf_view(k, i) = ev_view(offset + systems[k], i);
+         }
+      });
+   }
+   return;
+}
+
+void SystemDriver::ProjectShearRateSum(ParGridFunction &gdot_sum)
+{
+   if (mech_type == MechType::EXACMECH) {
+      std::string s_gdot = "gdot";
+      auto qf_mapping = model->GetQFMapping();
+      auto pair = qf_mapping->find(s_gdot)->second;
+      const int offset = pair.first;
+      const int nsys = pair.second;
+
+      Mesh *mesh = fe_space.GetMesh();
+      const FiniteElement &el = *fe_space.GetFE(0);
+      const IntegrationRule *ir = &(IntRules.Get(el.GetGeomType(), 2 * el.GetOrder() + 1));
+
+      const int nqpts = ir->GetNPoints();
+      const int nelems = fe_space.GetNE();
+
+      const double* W = ir->GetWeights().Read();
+      const GeometricFactors *geom = mesh->GetGeometricFactors(*ir, GeometricFactors::DETERMINANTS);
+
+      const int DIM2 = 2;
+      std::array<RAJA::idx_t, DIM2> perm2 {{ 1, 0 } };
+      RAJA::Layout<DIM2> layout_geom = RAJA::make_permuted_layout({{ nqpts, nelems } }, perm2);
+      RAJA::View<const double, RAJA::Layout<DIM2, RAJA::Index_type, 0> > j_view(geom->detJ.Read(), layout_geom);
+      // The absolute values are summed at the quadrature points, since the element
+      // averages of the individual shear rates could cancel each other out.
+      RAJA::View<const double, RAJA::Layout<DIM2> > sv_view(model->GetMatVars0()->Read(),
+                                                             model->GetStateVarsLayout());
+      double *sum_data = gdot_sum.Write();
+
+      MFEM_FORALL(i, nelems, {
+         double vol = 0.0;
+         double sum = 0.0;
+         for (int j = 0; j < nqpts; j++) {
+            const double wts = j_view(j, i) * W[j];
+            const int ipt = i * nqpts + j;
+            vol += wts;
+            for (int k = 0; k < nsys; k++) {
+               sum += fabs(sv_view(offset + k, ipt)) * wts;
+            }
+         }
+         sum_data[i] = sum / vol;
+      });
    }
    return;
 }
@@ -506,33 +1399,27 @@ void SystemDriver::ProjectOrientation(ParGridFunction &quats)
       auto qf_mapping = model->GetQFMapping();
       auto pair = qf_mapping->find(s_quats)->second;
 
-      VectorQuadratureFunctionCoefficient qfvc(*evec);
-      qfvc.SetComponent(pair.first, pair.second);
-      quats.ProjectDiscCoefficient(qfvc, mfem::GridFunction::ARITHMETIC);
+      ProjectElementAvgs(quats, pair.first, pair.second);
 
       // The below is normalizing the quaternion since it most likely was not
       // returned normalized
-      int _size = quats.Size();
-      int size = _size / 4;
-
-      double norm = 0;
-      double inv_norm = 0;
-      int index = 0;
+      const int size = quats.Size() / 4;
+      double* quat_data = quats.ReadWrite();
 
-      for (int i = 0; i < size; i++) {
-         index = i * 4;
+      MFEM_FORALL(i, size, {
+         const int index = i * 4;
 
-         norm = quats(index + 0) * quats(index + 0);
-         norm += quats(index + 1) * quats(index + 1);
-         norm += quats(index + 2) * quats(index + 2);
-         norm += quats(index + 3) * quats(index + 3);
+         double norm = quat_data[index + 0] * quat_data[index + 0];
+         norm += quat_data[index + 1] * quat_data[index + 1];
+         norm += quat_data[index + 2] * quat_data[index + 2];
+         norm += quat_data[index + 3] * quat_data[index + 3];
 
-         inv_norm = 1.0 / sqrt(norm);
+         const double inv_norm = 1.0 / sqrt(norm);
 
          for (int j = 0; j < 4; j++) {
-            quats(index + j) *= inv_norm;
+            quat_data[index + j] *= inv_norm;
          }
-      }
+      });
    }
    return;
 }
@@ -546,9 +1433,7 @@ void SystemDriver::ProjectH(ParGridFunction &h)
       auto qf_mapping = model->GetQFMapping();
       auto pair = qf_mapping->find(s_hard)->second;
 
-      VectorQuadratureFunctionCoefficient qfvc(*evec);
-      qfvc.SetComponent(pair.first, pair.second);
-      h.ProjectDiscCoefficient(qfvc, mfem::GridFunction::ARITHMETIC);
+      ProjectElementAvgs(h, pair.first, pair.second);
    }
    return;
 }
@@ -575,4 +1460,5 @@ SystemDriver::~SystemDriver()
    }
    delete newton_solver;
    delete mech_operator;
+   delete dp_mat;
 }
\ No newline at end of file
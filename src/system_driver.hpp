@@ -7,6 +7,8 @@
 #include "mechanics_solver.hpp"
 #include "option_parser.hpp"
 #include <iostream>
+#include <vector>
+#include <string>
 
 class SimVars
 {
@@ -49,14 +51,85 @@ class SystemDriver
       NonlinearMechOperator *mech_operator;
       RTModel class_device;
       bool postprocessing;
+      // Whether evec holds the element averages of the current beginning step state variables
+      bool evec_current;
       bool additional_avgs;
       mfem::QuadratureFunction &def_grad;
       std::string avg_stress_fname;
       std::string avg_pl_work_fname;
       std::string avg_def_grad_fname;
       std::string avg_dp_tensor_fname;
+      // Holds the plastic deformation rate tensor when the additional averages are
+      // computed for the ExaCMech models, so it doesn't overwrite def_grad
+      mfem::QuadratureFunction *dp_mat;
+      // The rank's volume weighted sums of the averaged quantities and their global sums.
+      // These are reduced with a non-blocking all reduce, so the communication overlaps with
+      // the next time step, and they're only written out once the reduction has finished.
+      mfem::Vector vol_elem_sums;
+      std::vector<double> vol_sums_loc;
+      std::vector<double> vol_sums_glob;
+      MPI_Request vol_sums_req;
+      bool vol_sums_pending;
 
       mfem::QuadratureFunction *evec;
+      // The slip systems that ProjectShearRate saves off (all of them if it's empty)
+      mfem::Array<int> shear_rate_systems;
+
+      // Raw quadrature point output related variables. The fields are saved off to
+      // the raw_qpt_dir directory and the element offset is the global index of
+      // this rank's first element.
+      bool raw_qpts;
+      std::vector<std::string> raw_qpt_fields;
+      std::string raw_qpt_dir;
+      long long raw_qpt_elem_offset;
+      mfem::Vector raw_qpt_buf;
+
+      // Per grain statistics related variables
+      bool grain_stats;
+      bool grain_stats_moments;
+      std::vector<std::string> grain_stats_fields;
+      std::string grain_stats_fname;
+      int grain_stats_ngrains;
+      mfem::Vector grain_elem_sums;
+
+      // In-situ lattice strain related variables. The plane normals of each hkl family
+      // are stored one after the other in the crystal frame with lattice_fam_offsets
+      // marking where each family starts, and the directions are unit vectors.
+      bool lattice_strains;
+      std::vector<std::vector<int> > lattice_hkls;
+      std::vector<std::vector<double> > lattice_dirs;
+      mfem::Vector lattice_normals;
+      mfem::Array<int> lattice_fam_offsets;
+      mfem::Vector lattice_dir_vecs;
+      double lattice_cos_tol;
+      std::string lattice_fname;
+      mfem::Vector lattice_elem_sums;
+
+      // In-situ histogram related variables. The field indices are the state variable
+      // index of each field, or -1 for the von Mises stress and -2 for the hydrostatic stress.
+      // The texture symmetry operators are stored as quaternions.
+      bool histograms;
+      std::vector<std::string> hist_fields;
+      mfem::Array<int> hist_field_inds;
+      mfem::Vector hist_ranges;
+      int hist_nbins;
+      std::string hist_fname;
+      bool texture;
+      int texture_nbins;
+      int texture_nsyms;
+      mfem::Vector texture_syms;
+      double texture_rmax[3];
+      std::string texture_fname;
+      mfem::Vector hist_data;
+      mfem::Vector hist_elem_vols;
+
+      // Returns whether the named quadrature point field is available
+      bool HasQptField(const std::string &name);
+      // Finds the quadrature function holding the named field along with the offset of
+      // the field within it, its number of components, and whether it's stored in a
+      // structure of arrays format.
+      void GetQptField(const std::string &name, const mfem::QuadratureFunction *&qf,
+                       int &offset, int &ncomps, bool &soa);
 
    public:
       SystemDriver(mfem::ParFiniteElementSpace &fes,
@@ -95,6 +168,11 @@ class SystemDriver
       /// step values
       void UpdateModel();
 
+      /// Waits on any outstanding volume average reduction and writes the
+      /// averages out to their files. This needs to be called after the last
+      /// time step so the last set of averages are saved off.
+      void FinalizeVolAvgs();
+
       void UpdateEssBdr(mfem::Array<int> &ess_bdr) const { mech_operator->UpdateEssTDofs(ess_bdr); }
 
       void ProjectVolume(mfem::ParGridFunction &vol);
@@ -105,7 +183,11 @@ class SystemDriver
       // These next group of Project* functions are only available with ExaCMech type models
       void ProjectDpEff(mfem::ParGridFunction &dpeff);
       void ProjectEffPlasticStrain(mfem::ParGridFunction &pleff);
+      // The shear rates are limited to the Visualizations.shear_rate_systems slip systems
+      // if they were provided, so gdot must have one vector component per slip system saved off
       void ProjectShearRate(mfem::ParGridFunction &gdot);
+      // The element average of the sum of the absolute shear rates over all of the slip systems
+      void ProjectShearRateSum(mfem::ParGridFunction &gdot_sum);
 
       // This one requires that the orientations be made unit normals afterwards
       void ProjectOrientation(mfem::ParGridFunction &quats);
@@ -120,7 +202,47 @@ class SystemDriver
 
       // Computes the element average of a quadrature function and stores it in a
       // vector. This is meant to be a helper function for the Project* methods.
-      void CalcElementAvg(mfem::Vector *elemVal, const mfem::QuadratureFunction *qf);
+      // If soa is true then the quadrature function data is taken to be in a structure
+      // of arrays format (see ExaModel::GetStateVarsLayout). The element averages
+      // are always in the normal vdim ordering.
+      void CalcElementAvg(mfem::Vector *elemVal, const mfem::QuadratureFunction *qf,
+                          const bool soa = false);
+
+      // Copies the components [offset, offset + length) of the state variable element
+      // averages over to an order 0 L2 grid function with length vector components.
+      void ProjectElementAvgs(mfem::ParGridFunction &gf, const int offset, const int length);
+
+      /// Writes out the raw quadrature point values of the requested fields for this rank
+      /// if the raw quadrature point output is turned on. Each rank writes its own binary file
+      /// that has the following layout where everything is in the native byte order:
+      /// char[8] "EXAQPTS", int32 version, int32 cycle, double time,
+      /// int64 nelems, int64 global element offset, int32 nqpts per element, int32 nfields,
+      /// then for each field: char[32] name, int32 ncomps, int64 byte offset of its data.
+      /// Each field's data is a double array with the components of a point next to each other,
+      /// and the points are ordered element by element.
+      void WriteRawQpts(const int cycle, const double time);
+
+      /// Computes the volume weighted averages (and optionally second moments) of the
+      /// requested fields over each grain, where the grain is the element attribute,
+      /// and rank 0 appends them to the grain statistics file.
+      /// A single MPI_Reduce is done for all of the grains and fields.
+      void WriteGrainStats(const int cycle, const double time);
+
+      /// Computes the lattice strains of a virtual diffraction experiment for each of the
+      /// hkl families and directions, and rank 0 appends them to the lattice strain file.
+      /// The lattice strain of a point is its elastic strain along the plane normal
+      /// of the hkl family that lies within the tolerance of the direction.
+      void WriteLatticeStrains(const int cycle, const double time);
+
+      /// Computes the volume weighted histograms of the requested scalar fields and of the
+      /// texture over the whole mesh, and rank 0 appends them to their files.
+      /// A single MPI_Reduce is done for all of the histograms.
+      void WriteHistograms(const int cycle, const double time);
+
+      // Computes the element averages of the state variables if they're out of date.
+      // This is called by the Project* methods that need them, so they're only
+      // computed on the time steps that are actually being visualized.
+      void UpdateElementAvgs();
 
       virtual ~SystemDriver();
 
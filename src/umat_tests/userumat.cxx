@@ -52,5 +52,69 @@ extern "C" {
            dfgrd0, dfgrd1, noel, npt, layer, kspt, kstep, kinc);
 
    }
+
+   // A batched entry point that just runs the Fortran umat one point at a time.
+   // It mostly serves as an example of the ordering of the batched interface.
+   UMAT_API void
+   umat_batch(int *nblock, int *nstatv, int *nprops, real8 *props,
+              real8 *deltaTime, real8 *time, real8 *celent,
+              real8 *stran, real8 *dstran, real8 *drot,
+              real8 *dfgrd0, real8 *dfgrd1,
+              real8 *stress, real8 *statev, real8 *ddsdde)
+   {
+      const int nb = *nblock;
+      // Abaqus ordering (11, 22, 33, 12, 13, 23) to our ordering (11, 22, 33, 23, 13, 12)
+      const int abq[6] = { 0, 1, 2, 5, 4, 3 };
+      int ndi = 3, nshr = 3, ntens = 6;
+      int layer = 0, kspt = 0, kstep = 0, kinc = 0;
+      real8 stress_pt[6], stran_pt[6], dstran_pt[6], ddsdde_pt[36];
+      real8 ddsdt[6], drplde[6], drot_pt[9], dfgrd0_pt[9], dfgrd1_pt[9];
+      real8 *statev_pt = new real8[*nstatv];
+
+      for (int ib = 0; ib < nb; ib++) {
+         real8 sse = 0.0, spd = 0.0, scd = 0.0, rpl = 0.0, drpldt = 0.0;
+         real8 tempk = 300.0, dtemp = 0.0, predef = 0.0, dpred = 0.0, cmname = 0.0;
+         real8 pnewdt = 10.0, celent_pt = celent[ib];
+         real8 coords[3] = { 0.0, 0.0, 0.0 };
+         int noel = ib, npt = 0;
+
+         for (int i = 0; i < 6; i++) {
+            stress_pt[i] = stress[ib + nb * abq[i]];
+            stran_pt[i] = stran[ib + nb * abq[i]];
+            dstran_pt[i] = dstran[ib + nb * abq[i]];
+            ddsdt[i] = 0.0;
+            drplde[i] = 0.0;
+         }
+         for (int i = 0; i < 36; i++) {
+            ddsdde_pt[i] = 0.0;
+         }
+         for (int i = 0; i < 9; i++) {
+            drot_pt[i] = drot[ib + nb * i];
+            dfgrd0_pt[i] = dfgrd0[ib + nb * i];
+            dfgrd1_pt[i] = dfgrd1[ib + nb * i];
+         }
+         for (int i = 0; i < *nstatv; i++) {
+            statev_pt[i] = statev[ib + nb * i];
+         }
+
+         UMAT(stress_pt, statev_pt, ddsdde_pt, &sse, &spd, &scd, &rpl,
+              ddsdt, drplde, &drpldt, stran_pt, dstran_pt, time, deltaTime,
+              &tempk, &dtemp, &predef, &dpred, &cmname, &ndi, &nshr, &ntens,
+              nstatv, props, nprops, coords, drot_pt, &pnewdt, &celent_pt,
+              dfgrd0_pt, dfgrd1_pt, &noel, &npt, &layer, &kspt, &kstep, &kinc);
+
+         for (int i = 0; i < 6; i++) {
+            stress[ib + nb * abq[i]] = stress_pt[i];
+            for (int j = 0; j < 6; j++) {
+               ddsdde[ib + nb * (abq[i] + 6 * abq[j])] = ddsdde_pt[i + 6 * j];
+            }
+         }
+         for (int i = 0; i < *nstatv; i++) {
+            statev[ib + nb * i] = statev_pt[i];
+         }
+      }
+
+      delete[] statev_pt;
+   }
       
 }
@@ -45,6 +45,22 @@ extern "C" {
         real8 *drot, real8 *pnewdt, real8 *celent,
         real8 *dfgrd0, real8 *dfgrd1, int *noel, int *npt,
         int *layer, int *kspt, int *kstep, int *kinc);
+
+   // The C entry point for a batched material model. Rather than being called
+   // for a single point, it's called on a block of nblock points at a time, and
+   // everything is already in ExaConstit's Voigt ordering (11, 22, 33, 23, 13, 12)
+   // with engineering shear strains. Each array is laid out like a Fortran
+   // (nblock, ncomp) array, so component j of point i is at [i + nblock * j],
+   // which lets the model vectorize over the points. The 3x3 matrices are stored
+   // in column major order as the 9 components, and ddsdde(i, j) (component i + 6 j)
+   // is the change in the ith stress component due to the jth strain increment.
+   // The material properties and time increment are the same for all points.
+   UMAT_API void
+   umat_batch(int *nblock, int *nstatv, int *nprops, real8 *props,
+              real8 *deltaTime, real8 *time, real8 *celent,
+              real8 *stran, real8 *dstran, real8 *drot,
+              real8 *dfgrd0, real8 *dfgrd1,
+              real8 *stress, real8 *statev, real8 *ddsdde);
 }
 
 
@@ -3,6 +3,7 @@
 #include "mfem/general/forall.hpp"
 #include "mechanics_integrators.hpp"
 #include "mechanics_umat.hpp"
+#include "mechanics_kernels.hpp"
 #include <string>
 #include <sstream>
 #include "RAJA/RAJA.hpp"
@@ -624,6 +625,140 @@ double ICExaNLFIntegratorEATest()
    return difference / mag;
 }
 
+// This function compares the difference in the formation of the GetGradient operator and then multiplying it
+// by the necessary vector, and the matrix-free partial assembly formulation which avoids forming the matrix.
+// It's been tested on higher order elements and multiple elements. The difference in these two methods
+// should be 0.0.
+template<bool cmat_ones>
+double ICExaNLFIntegratorPATest()
+{
+   int dim = 3;
+   int order = 3;
+   mfem::ParMesh *pmesh = nullptr;
+   {
+      // Making this mesh and test real simple with 8 cubic element
+      mfem::Mesh mesh = Mesh::MakeCartesian3D(2, 2, 2, Element::HEXAHEDRON, 1.0, 1.0, 1.0, false);
+      mesh.SetCurvature(order);
+      pmesh = new mfem::ParMesh(MPI_COMM_WORLD, mesh);
+   }
+   H1_FECollection fec(order, dim);
+
+   ParFiniteElementSpace fes(pmesh, &fec, dim);
+
+   // All of these Quadrature function variables are needed to instantiate our material model
+   // We can just ignore this marked section
+   /////////////////////////////////////////////////////////////////////////////////////////
+   // Define a quadrature space and material history variable QuadratureFunction.
+   int intOrder = 2 * order + 1;
+   QuadratureSpace qspace(pmesh, intOrder); // 3rd order polynomial for 2x2x2 quadrature
+   // for first order finite elements.
+   QuadratureFunction q_matVars0(&qspace, 1);
+   QuadratureFunction q_matVars1(&qspace, 1);
+   QuadratureFunction q_sigma0(&qspace, 1);
+   QuadratureFunction q_sigma1(&qspace, 1);
+   // We'll modify this before doing the partial assembly
+   // This is our stiffness matrix and is a 6x6 due to major and minor symmetry
+   // of the 4th order tensor which has dimensions 3x3x3x3.
+   QuadratureFunction q_matGrad(&qspace, 36);
+   QuadratureFunction q_kinVars0(&qspace, 9);
+   QuadratureFunction q_vonMises(&qspace, 1);
+   ParGridFunction beg_crds(&fes);
+   ParGridFunction end_crds(&fes);
+   // We'll want to update this later in case we do anything more complicated.
+   Vector matProps(1);
+
+   end_crds = 1.0;
+
+   ExaModel *model;
+   // This doesn't really matter and is just needed for the integrator class.
+   model = new AbaqusUmatModel(&q_sigma0, &q_sigma1, &q_matGrad, &q_matVars0, &q_matVars1, &q_kinVars0,
+                               &beg_crds, &end_crds, &matProps, 1, 1, &fes, true);
+   // Model time needs to be set.
+   model->SetModelDt(1.0);
+   /////////////////////////////////////////////////////////////////////////////
+   ExaNLFIntegrator* nlf_int;
+
+   nlf_int = new ICExaNLFIntegrator(dynamic_cast<AbaqusUmatModel*>(model));
+
+   const FiniteElement &el = *fes.GetFE(0);
+   ElementTransformation *Ttr;
+
+   // So, we're going to originally support non tensor-product type elements originally.
+   const ElementDofOrdering ordering = ElementDofOrdering::NATIVE;
+   // const ElementDofOrdering ordering = ElementDofOrdering::LEXICOGRAPHIC;
+   const Operator *elem_restrict_lex;
+   elem_restrict_lex = fes.GetElementRestriction(ordering);
+   // Set our field variable to a linear spacing so 1 ... ndofs in field
+   Vector xtrue(end_crds.Size());
+   for (int i = 0; i < xtrue.Size(); i++) {
+      xtrue(i) = i + 1;
+   }
+
+   // For multiple elements xtrue and local_x are differently sized
+   Vector local_x(elem_restrict_lex->Height());
+   // All of our local global solution variables
+   Vector y_fa(end_crds.Size());
+   Vector local_y_fa(elem_restrict_lex->Height());
+   Vector local_y_pa(elem_restrict_lex->Height());
+   Vector y_pa(end_crds.Size());
+   // Initializing them all to 1.
+   y_fa = 0.0;
+   y_pa = 0.0;
+   local_y_pa = 0.0;
+   local_y_fa = 0.0;
+   // Get our local x values (element values) from the global vector
+   elem_restrict_lex->Mult(xtrue, local_x);
+   // Variables used to kinda mimic what the NonlinearForm::GetGradient does.
+   int ndofs = el.GetDof() * el.GetDim();
+   Vector elfun(ndofs), elresults(ndofs);
+   DenseMatrix elmat;
+
+   // Set our CMat array for the non-PA case
+   q_matGrad = 0.0;
+   setCMat<cmat_ones>(q_matGrad);
+   elfun.HostReadWrite();
+   elresults.HostReadWrite();
+   local_x.HostReadWrite();
+   local_y_fa.HostReadWrite();
+   for (int i = 0; i < fes.GetNE(); i++) {
+      Ttr = fes.GetElementTransformation(i);
+      for (int j = 0; j < ndofs; j++) {
+         elfun(j) = local_x((i * ndofs) + j);
+      }
+
+      nlf_int->AssembleElementGrad(el, *Ttr, elfun, elmat);
+      // Getting out the local action of our gradient operator on
+      // the local x values and then saving the results off to the
+      // global variable.
+      elresults = 0.0;
+      elmat.AddMult(elfun, elresults);
+      for (int j = 0; j < ndofs; j++) {
+         local_y_fa((i * ndofs) + j) = elresults(j);
+      }
+   }
+
+   // Perform the setup and action operation of our PA operation
+   // The Bbar version needs the element averaged shape function gradients from AssemblePA
+   nlf_int->AssemblePA(fes);
+   nlf_int->AssembleGradPA(fes);
+   nlf_int->AddMultGradPA(local_x, local_y_pa);
+
+   // Take all of our multiple elements and go back to the L vector.
+   elem_restrict_lex->MultTranspose(local_y_fa, y_fa);
+   elem_restrict_lex->MultTranspose(local_y_pa, y_pa);
+   // Find out how different our solutions were from one another.
+   double mag = y_fa.Norml2();
+   std::cout << "y_fa mag: " << mag << std::endl;
+   y_fa -= y_pa;
+   double difference = y_fa.Norml2();
+   // Free up memory now.
+   delete nlf_int;
+   delete model;
+   delete pmesh;
+
+   return difference / mag;
+}
+
 // This function compares the difference in the formation of the Mult operator and then multiplying it
 // by the necessary vector, and the matrix-free partial assembly formulation.
 // It's been tested on higher order elements and multiple elements. The difference in these two methods
@@ -817,6 +952,93 @@ TEST(exaconstit, ic_ea_assembly)
    EXPECT_LT(fabs(difference), 2e-14) << "Did not get expected value for pa vec";
 }
 
+TEST(exaconstit, ic_partial_assembly)
+{
+   double difference = ICExaNLFIntegratorPATest<false>();
+   std::cout << difference << std::endl;
+   EXPECT_LT(fabs(difference), 1.0e-14) << "Did not get expected value for pa false";
+   difference = ICExaNLFIntegratorPATest<true>();
+   std::cout << difference << std::endl;
+   EXPECT_LT(fabs(difference), 1.0e-14) << "Did not get expected value for pa true";
+}
+
+TEST(exaconstit, lattice_family_normals)
+{
+   // The {111} planes of a cubic crystal are the 4 octahedral planes and the {200} planes
+   // are the 3 cube planes.
+   std::vector<double> normals;
+   exaconstit::kernel::CubicFamilyNormals({ 1, 1, 1 }, normals);
+   EXPECT_EQ(normals.size(), 4u * 3u) << "Did not get expected number of {111} normals";
+   normals.clear();
+   exaconstit::kernel::CubicFamilyNormals({ 2, 0, 0 }, normals);
+   EXPECT_EQ(normals.size(), 3u * 3u) << "Did not get expected number of {200} normals";
+   normals.clear();
+   exaconstit::kernel::CubicFamilyNormals({ 2, 2, 0 }, normals);
+   EXPECT_EQ(normals.size(), 6u * 3u) << "Did not get expected number of {220} normals";
+
+   for (size_t i = 0; i < normals.size(); i += 3) {
+      const double norm = normals[i] * normals[i] + normals[i + 1] * normals[i + 1]
+                          + normals[i + 2] * normals[i + 2];
+      EXPECT_LT(fabs(norm - 1.0), 1.0e-14) << "Plane normal is not a unit vector";
+   }
+}
+
+TEST(exaconstit, crystal_symmetries)
+{
+   // The proper rotations of the cubic group (24) and of the hexagonal group (12)
+   const XtalType xtals[2] = { XtalType::FCC, XtalType::HCP };
+   const size_t nsyms[2] = { 24, 12 };
+   for (int x = 0; x < 2; x++) {
+      std::vector<double> syms;
+      exaconstit::kernel::CrystalSymmetries(xtals[x], syms);
+      EXPECT_EQ(syms.size(), nsyms[x] * 4u) << "Did not get expected number of symmetry operators";
+
+      const size_t nquats = syms.size() / 4;
+      for (size_t i = 0; i < nquats; i++) {
+         double norm = 0.0;
+         for (int k = 0; k < 4; k++) {
+            norm += syms[4 * i + k] * syms[4 * i + k];
+         }
+         EXPECT_LT(fabs(norm - 1.0), 1.0e-14) << "Symmetry operator is not a unit quaternion";
+         // q and -q are the same rotation so no two operators should have |q_i . q_j| = 1
+         for (size_t j = i + 1; j < nquats; j++) {
+            double dot = 0.0;
+            for (int k = 0; k < 4; k++) {
+               dot += syms[4 * i + k] * syms[4 * j + k];
+            }
+            EXPECT_LT(fabs(dot), 1.0 - 1.0e-10) << "Symmetry operators " << i << " and " << j << " are the same rotation";
+         }
+      }
+   }
+}
+
+TEST(exaconstit, vecd_to_tensor)
+{
+   // A symmetric deviatoric tensor is put into ExaCMech's vecd format and then back again
+   // with a volumetric part added to it.
+   const double tensor[9] = { 0.3, 0.1, -0.2,
+                              0.1, -0.5, 0.4,
+                              -0.2, 0.4, 0.2 };
+   const double vol = 0.01;
+   const double vecd[5] = { (tensor[0] - tensor[4]) / sqrt(2.0),
+                            sqrt(1.5) * tensor[8],
+                            sqrt(2.0) * tensor[1],
+                            sqrt(2.0) * tensor[2],
+                            sqrt(2.0) * tensor[5] };
+   double result[9];
+   exaconstit::kernel::VecdToTensor(vecd, vol, result);
+
+   double difference = 0.0;
+   for (int i = 0; i < 3; i++) {
+      for (int j = 0; j < 3; j++) {
+         const double expected = tensor[3 * i + j] + ((i == j) ? vol : 0.0);
+         difference += fabs(result[3 * i + j] - expected);
+      }
+   }
+   std::cout << difference << std::endl;
+   EXPECT_LT(difference, 1.0e-14) << "Did not get expected value for vecd to tensor";
+}
+
 int main(int argc, char *argv[])
 {
    // Initialize MPI.
@@ -141,12 +141,105 @@ def runExtra():
     pool.join()
     return True
 
+def read_rows(fname):
+    rows = []
+    with open(fname) as csvfile:
+        readcsv = csv.reader(csvfile, delimiter=' ')
+        for row in readcsv:
+            rows.append(row)
+    return rows
+
+# The in-situ post-processing outputs don't have reference files of their own,
+# so they're checked for their internal consistency instead.
+def check_vis(pwd, tresult, test_case):
+    base = pwd + '/test_' + tresult
+    stress = [[float(v) for v in row] for row in read_rows(base + '_stress.txt')]
+    # The volume weighted average of the per grain stresses should be the mesh's average stress
+    steps = {}
+    for row in read_rows(base + '_grain_stats.txt'):
+        vals = [float(v) for v in row]
+        steps.setdefault(int(vals[0]), []).append(vals[3:])
+    if len(steps) != len(stress):
+        raise ValueError("The grain stats don't cover every step: ", test_case)
+    for step, avg in zip(sorted(steps), stress):
+        tot_vol = sum(grain[0] for grain in steps[step])
+        tol = 1.0e-5 * max(abs(a) for a in avg) + 1.0e-12
+        for k in range(6):
+            gavg = sum(grain[0] * grain[k + 1] for grain in steps[step]) / tot_vol
+            if abs(gavg - avg[k]) > tol:
+                raise ValueError("The grain stats don't match the average stress: ", test_case)
+    # Every bin pair of the lattice strains is written each step, and only a fraction of
+    # the volume can diffract
+    lattice = [[float(v) for v in row] for row in read_rows(base + '_lattice_strains.txt')]
+    if len(lattice) != 3 * 2 * len(stress):
+        raise ValueError("The lattice strains don't cover every step: ", test_case)
+    for row in lattice:
+        if row[8] < 0.0 or row[8] > 1.0 or row[10] < 0.0:
+            raise ValueError("The lattice strains have invalid volume fractions: ", test_case)
+    # Values outside of a histogram's range go in its end bins so all of the volume is binned.
+    # The fractions are only written out with 8 significant digits.
+    for row in read_rows(base + '_histograms.txt'):
+        if abs(sum(float(v) for v in row[5:]) - 1.0) > 1.0e-6:
+            raise ValueError("The histogram volume fractions don't sum to 1: ", test_case)
+    for row in read_rows(base + '_texture.txt'):
+        if len(row) != 2 + 8 ** 3 or abs(sum(float(v) for v in row[2:]) - 1.0) > 1.0e-6:
+            raise ValueError("The texture volume fractions don't sum to 1: ", test_case)
+    return True
+
+# The files written out by the post-processing test case
+vis_suffixes = ['_stress.txt', '_grain_stats.txt', '_lattice_strains.txt',
+                '_histograms.txt', '_texture.txt']
+
+def runVisSystemCommands(params):
+    test, ans = params
+    print("Now running test case: " + test)
+    result = subprocess.run('pwd', stdout=subprocess.PIPE)
+    pwd = result.stdout.decode('utf-8')
+    cmd = 'mpirun -np 2 ' + pwd.rstrip() + '/../bin/mechanics -opt ' + test
+    subprocess.run(cmd.rstrip(), stdout=subprocess.PIPE, shell=True)
+    # The post-processing doesn't change the solution so the stress is compared against
+    # the same reference file as the case without it
+    ans_pwd = pwd.rstrip() + '/' + ans
+    tresult = test.split(".")[0]
+    test_pwd = pwd.rstrip() + '/test_'+tresult+'_stress.txt'
+    check_stress(ans_pwd, test_pwd, test)
+    check_vis(pwd.rstrip(), tresult, test)
+    for suffix in vis_suffixes:
+        cmd = 'rm ' + pwd.rstrip() + '/test_'+tresult+suffix
+        subprocess.run(cmd.rstrip(), stdout=subprocess.PIPE, shell=True)
+    return True
+
+def runVis():
+    test_cases = ["voce_ea_vis.toml"]
+
+    test_results = ["voce_ea_stress.txt"]
+
+    result = subprocess.run('pwd', stdout=subprocess.PIPE)
+
+    pwd = result.stdout.decode('utf-8')
+
+    # Remove any output file that might already be living in the test directory
+    # since all of these files are appended to
+    for test in test_cases:
+        tresult = test.split(".")[0]
+        for suffix in vis_suffixes:
+            cmd = 'rm ' + pwd.rstrip() + '/test_'+tresult+suffix
+            result = subprocess.run(cmd.rstrip(), stdout=subprocess.PIPE, shell=True)
+
+    params =  zip(test_cases, test_results)
+
+    for param in params:
+        runVisSystemCommands(param)
+    return True
+
 class TestUnits(unittest.TestCase):
     def test_all_cases(self):
         actual = run()
         actualExtra = runExtra()
+        actualVis = runVis()
         self.assertTrue(actual)
         self.assertTrue(actualExtra)
+        self.assertTrue(actualVis)
 
 if __name__ == '__main__':
     unittest.main()
\ No newline at end of file